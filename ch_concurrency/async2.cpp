@@ -7,6 +7,10 @@
 #include <thread>
 #include <vector>
 
+#include "reproducible_sum.h"
+#include "simd_math.h"
+#include "thread_pool.h"
+
 // Function to perform a computationally intensive task
 double heavyComputation(double *arr, size_t start, size_t end)
 {
@@ -54,6 +58,31 @@ double processAsync(double *data, size_t size, int numThreads)
     return sum;
 }
 
+// Function to process data on a persistent pool, pieces are balanced by work stealing
+double processPool(ThreadPool &pool, double *data, size_t size)
+{
+    return pool.parallelReduce(
+        0, size, 0, 0.0, [data](size_t start, size_t end) { return heavyComputation(data, start, end); },
+        [](double a, double b) { return a + b; });
+}
+
+// Function to process data on the pool with the vectorised kernel
+double processPoolSimd(ThreadPool &pool, double *data, size_t size)
+{
+    return pool.parallelReduce(
+        0, size, 0, 0.0, [data](size_t start, size_t end) { return simd::heavyComputation(data, start, end, 1000); },
+        [](double a, double b) { return a + b; });
+}
+
+// Function to process data reproducibly, fixed blocks are summed in a fixed
+// pairwise tree, so the sum does not depend on the number of threads
+double processReproducible(ThreadPool &pool, double *data, size_t size)
+{
+    return reproducibleReduce(pool, size, [data](size_t start, size_t end, CompensatedSum &sum) {
+        sum.add(heavyComputation(data, start, end));
+    });
+}
+
 int main()
 {
     const size_t dataSize = 5000000;
@@ -66,9 +95,12 @@ int main()
     std::println("Allocating and initializing arrays...");
     auto seqData = std::make_unique< double[] >(dataSize);
     auto parData = std::make_unique< double[] >(dataSize);
+    auto poolData = std::make_unique< double[] >(dataSize);
+    auto repData = std::make_unique< double[] >(dataSize);
 
     std::generate_n(seqData.get(), dataSize, []() { return 1.0; });
     std::generate_n(parData.get(), dataSize, []() { return 1.0; });
+    std::generate_n(poolData.get(), dataSize, []() { return 1.0; });
 
     // Sequential processing
     std::println("Running sequentially...");
@@ -88,9 +120,72 @@ int main()
     auto elapsedPar = std::chrono::duration< double >(endPar - startPar).count();
     std::println("Parallel   - Time: {:.4f} s, Sum: {:.6f}\n", elapsedPar, parSum);
 
+    // Thread pool processing
+    std::println("Running on thread pool...");
+    ThreadPool pool(numThreads);
+    auto startPool = std::chrono::high_resolution_clock::now();
+    double poolSum = processPool(pool, poolData.get(), dataSize);
+    auto endPool = std::chrono::high_resolution_clock::now();
+
+    auto elapsedPool = std::chrono::duration< double >(endPool - startPool).count();
+    std::println("Pool       - Time: {:.4f} s, Sum: {:.6f}\n", elapsedPool, poolSum);
+
+    // Vectorised processing on the pool
+    std::println("Running SIMD ({} doubles per instruction) on thread pool...", simd::packetSize);
+    auto simdData = std::make_unique< double[] >(dataSize);
+    std::generate_n(simdData.get(), dataSize, []() { return 1.0; });
+    auto startSimd = std::chrono::high_resolution_clock::now();
+    double simdSum = processPoolSimd(pool, simdData.get(), dataSize);
+    auto endSimd = std::chrono::high_resolution_clock::now();
+
+    auto elapsedSimd = std::chrono::duration< double >(endSimd - startSimd).count();
+    std::println("SIMD pool  - Time: {:.4f} s, Sum: {:.6f}\n", elapsedSimd, simdSum);
+
+    // Reproducible processing, on the pool and on a single thread
+    std::println("Running reproducibly...");
+    std::generate_n(repData.get(), dataSize, []() { return 1.0; });
+    auto startRep = std::chrono::high_resolution_clock::now();
+    double repSum = processReproducible(pool, repData.get(), dataSize);
+    auto endRep = std::chrono::high_resolution_clock::now();
+
+    auto elapsedRep = std::chrono::duration< double >(endRep - startRep).count();
+    std::println("Reproducible - Time: {:.4f} s, Sum: {:.17g}", elapsedRep, repSum);
+
+    ThreadPool serialPool(1);
+    std::generate_n(repData.get(), dataSize, []() { return 1.0; });
+    double repSerialSum = processReproducible(serialPool, repData.get(), dataSize);
+
+    std::println("Reproducible on 1 thread - Sum: {:.17g} ({})\n", repSerialSum,
+                 repSerialSum == repSum ? "identical" : "differs");
+
+    // Many small calls, std::async starts new threads on every call
+    const size_t callSize = 20;
+    const int calls = 2000;
+
+    auto startCalls = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+        processAsync(parData.get() + i * callSize, callSize, numThreads);
+    auto endCalls = std::chrono::high_resolution_clock::now();
+    auto elapsedAsyncCalls = std::chrono::duration< double >(endCalls - startCalls).count();
+
+    startCalls = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+        processPool(pool, poolData.get() + i * callSize, callSize);
+    endCalls = std::chrono::high_resolution_clock::now();
+    auto elapsedPoolCalls = std::chrono::duration< double >(endCalls - startCalls).count();
+
+    std::println("{} calls of {} elements", calls, callSize);
+    std::println("Time per call, std::async: {:.1f} us", elapsedAsyncCalls / calls * 1e6);
+    std::println("Time per call, thread pool: {:.1f} us\n", elapsedPoolCalls / calls * 1e6);
+
     // Results summary
     std::println("--- Performance Metrics ---");
     std::println("Speedup: {:.2f}x", elapsedSeq / elapsedPar);
+    std::println("Speedup (pool): {:.2f}x", elapsedSeq / elapsedPool);
+    std::println("Speedup (reproducible): {:.2f}x, {:+.1f}% time vs futures", elapsedSeq / elapsedRep,
+                 (elapsedRep / elapsedPar - 1.0) * 100);
+    std::println("Speedup (SIMD pool): {:.2f}x, SIMD over scalar pool {:.2f}x", elapsedSeq / elapsedSimd,
+                 elapsedPool / elapsedSimd);
     std::println("Efficiency: {:.1f}%", (elapsedSeq / elapsedPar / numThreads) * 100);
     
     double sumDiff = std::abs(seqSum - parSum);
@@ -1,145 +1,103 @@
-#include <Eigen/Dense>
-#include <iomanip>
+#include <cstdlib>
 #include <iostream>
 #include <omp.h>
+#include <string>
 
-class StencilComputation {
-private:
-    Eigen::MatrixXd current_grid;
-    Eigen::MatrixXd next_grid;
-    int size;
+#include "stencil_computation.h"
 
-public:
-    StencilComputation(int n) : size(n)
-    {
-        current_grid = Eigen::MatrixXd::Zero(n, n);
-        next_grid = Eigen::MatrixXd::Zero(n, n);
-    }
+enum class Engine
+{
+    NAIVE,
+    BLOCKED,
+    TEMPORAL
+};
+
+double run(StencilComputation &stencil, Engine engine, int max_iter, int time_block)
+{
+    stencil.initialize();
+
+    double start_time = omp_get_wtime();
+
+    // Time stepping
+    int iter = 0;
 
-    void initialize()
+    while (iter < max_iter)
     {
-// Set initial conditions
-#pragma omp parallel for collapse(2)
-        for (int i = 1; i < size - 1; i++)
+        switch (engine)
         {
-            for (int j = 1; j < size - 1; j++)
-            {
-                current_grid(i, j) = 0.0;
-            }
+        case Engine::NAIVE:
+            stencil.step();
+            iter++;
+            break;
+        case Engine::BLOCKED:
+            stencil.step_blocked();
+            iter++;
+            break;
+        case Engine::TEMPORAL: {
+            int steps = std::min(time_block, max_iter - iter);
+            stencil.step_temporal(steps);
+            iter += steps;
+            break;
         }
-
-// Set boundary conditions
-#pragma omp parallel sections
-        {
-#pragma omp section
-            {
-                // Top boundary
-                for (int j = 0; j < size; j++)
-                {
-                    current_grid(0, j) = 100.0;
-                    next_grid(0, j) = 100.0;
-                }
-            }
-#pragma omp section
-            {
-                // Bottom boundary
-                for (int j = 0; j < size; j++)
-                {
-                    current_grid(size - 1, j) = 0.0;
-                    next_grid(size - 1, j) = 0.0;
-                }
-            }
-#pragma omp section
-            {
-                // Left boundary
-                for (int i = 0; i < size; i++)
-                {
-                    current_grid(i, 0) = 50.0;
-                    next_grid(i, 0) = 50.0;
-                }
-            }
-#pragma omp section
-            {
-                // Right boundary
-                for (int i = 0; i < size; i++)
-                {
-                    current_grid(i, size - 1) = 50.0;
-                    next_grid(i, size - 1) = 50.0;
-                }
-            }
         }
     }
 
-    void step()
-    {
-// Compute next timestep
-#pragma omp parallel for collapse(2)
-        for (int i = 1; i < size - 1; i++)
-        {
-            for (int j = 1; j < size - 1; j++)
-            {
-                next_grid(i, j) = 0.25 * (current_grid(i - 1, j) + current_grid(i + 1, j) + current_grid(i, j - 1) +
-                                          current_grid(i, j + 1));
-            }
-        }
+    double end_time = omp_get_wtime();
 
-        // Swap grids
-        std::swap(current_grid, next_grid);
-    }
+    return end_time - start_time;
+}
 
-    void print_grid() const
-    {
-        for (int i = 0; i < size; i++)
-        {
-            for (int j = 0; j < size; j++)
-            {
-                std::cout << std::fixed << std::setprecision(1) << current_grid(i, j) << " ";
-            }
-            std::cout << "\n";
-        }
-    }
+void report(const std::string &name, double seconds, int N, int max_iter)
+{
+    // Lattice updates and the memory traffic of a plain sweep (one read and
+    // one write of the grid per time step). For the temporally tiled engine
+    // the GB/s figure is the effective bandwidth a plain sweep would need.
 
-    double get_value(int i, int j) const
-    {
-        return current_grid(i, j);
-    }
-};
+    double updates = double(N - 2) * double(N - 2) * max_iter;
+    double bytes = 2.0 * sizeof(double) * double(N) * double(N) * max_iter;
 
-int main()
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds << " s" << std::setw(10) << updates / seconds / 1e9 << " GLUP/s"
+              << std::setw(10) << bytes / seconds / 1e9 << " GB/s\n";
+}
+
+int main(int argc, char *argv[])
 {
-    const int N = 6000;       // Grid size
-    const int max_iter = 100; // Number of iterations
+    int N = 6000;       // Grid size
+    int max_iter = 100; // Number of iterations
+    int time_block = 8; // Time steps fused per pass by the temporal engine
+
+    if (argc > 1)
+        N = std::atoi(argv[1]);
+    if (argc > 2)
+        max_iter = std::atoi(argv[2]);
+    if (argc > 3)
+        time_block = std::atoi(argv[3]);
 
     // Set number of OpenMP threads
     omp_set_num_threads(8);
 
+    std::cout << "Grid size " << N << " x " << N << ", " << max_iter << " iterations, " << omp_get_max_threads()
+              << " threads\n\n";
+
     StencilComputation stencil(N);
-    stencil.initialize();
 
-    std::cout << "Initial state:\n";
-    // stencil.print_grid();
+    double t = run(stencil, Engine::NAIVE, max_iter, time_block);
+    report("naive", t, N, max_iter);
 
-    double start_time = omp_get_wtime();
+    Eigen::MatrixXd reference = stencil.grid();
 
-    // Time stepping
-    for (int iter = 0; iter < max_iter; iter++)
-    {
-        stencil.step();
+    t = run(stencil, Engine::BLOCKED, max_iter, time_block);
+    report("blocked", t, N, max_iter);
 
-        if (iter % 20 == 0)
-        {
-#pragma omp single
-            {
-                std::cout << "Completed iteration " << iter << "\n";
-            }
-        }
-    }
+    bool identical = (stencil.grid() == reference);
 
-    double end_time = omp_get_wtime();
+    t = run(stencil, Engine::TEMPORAL, max_iter, time_block);
+    report("temporal", t, N, max_iter);
+
+    identical = identical && (stencil.grid() == reference);
 
-    std::cout << "\nFinal state:\n";
-    // stencil.print_grid();
-    std::cout << "Computation took " << end_time - start_time << " seconds\n";
+    std::cout << "\nResults identical to naive sweep: " << (identical ? "yes" : "no") << "\n";
 
     return 0;
 }
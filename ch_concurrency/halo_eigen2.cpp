@@ -0,0 +1,81 @@
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <omp.h>
+#include <string>
+
+#include "stencil_computation.h"
+
+// Solves the steady state of the halo_eigen1 heat problem to a given
+// tolerance instead of running a fixed number of steps. The residual is the
+// max-norm of the Jacobi correction, 0.25 * |sum of neighbours - 4u|.
+
+void run(const std::string &name, StencilComputation &stencil, std::function<double()> iteration, double tol,
+         int max_iter)
+{
+    stencil.initialize();
+
+    double start_time = omp_get_wtime();
+
+    int iter = 0;
+    double res = 0.0;
+
+    while (iter < max_iter)
+    {
+        res = iteration();
+        iter++;
+
+        if (res < tol)
+            break;
+    }
+
+    double end_time = omp_get_wtime();
+
+    std::cout << std::left << std::setw(12) << name << std::right << std::setw(8) << iter << " iterations"
+              << std::scientific << std::setprecision(2) << std::setw(11) << res << " residual" << std::fixed
+              << std::setprecision(3) << std::setw(10) << end_time - start_time << " s"
+              << (res < tol ? "" : "  (not converged)") << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int N = 513;           // Grid size
+    double tol = 1e-6;     // Residual tolerance
+    int max_iter = 100000; // Iteration limit for each solver
+
+    if (argc > 1)
+        N = std::atoi(argv[1]);
+    if (argc > 2)
+        tol = std::atof(argv[2]);
+    if (argc > 3)
+        max_iter = std::atoi(argv[3]);
+
+    std::cout << "Grid size " << N << " x " << N << ", tolerance " << tol << ", " << omp_get_max_threads()
+              << " threads\n\n";
+
+    {
+        StencilComputation stencil(N);
+        run("jacobi", stencil, [&]() { return stencil.step_jacobi(); }, tol, max_iter);
+    }
+
+    // The in-place solvers do not allocate the second grid
+
+    {
+        StencilComputation stencil(N, true);
+        run("gauss-seidel", stencil, [&]() { return stencil.step_sor(1.0); }, tol, max_iter);
+    }
+
+    {
+        StencilComputation stencil(N, true);
+        double omega = stencil.optimal_omega();
+        run("sor", stencil, [&]() { return stencil.step_sor(omega); }, tol, max_iter);
+    }
+
+    {
+        StencilComputation stencil(N, true);
+        run("multigrid", stencil, [&]() { return stencil.vcycle(2, 2); }, tol, max_iter);
+    }
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <mpi.h>
+#include <vector>
+
+#include "stencil_computation.h"
+
+// Domain-decomposed version of the halo_eigen1 heat diffusion solver. The
+// global N x N grid is split into a 2D grid of tiles, one per MPI rank. Each
+// tile is stored with a ghost layer of width 1 that is refreshed from the
+// neighbouring ranks before every step. The exchange is non-blocking and
+// the interior of the tile, which does not depend on the ghost layer, is
+// computed while the messages are in flight.
+
+class DistributedStencil {
+private:
+    MPI_Comm cart;
+    int rank;
+    int dims[2] = {0, 0};
+    int coords[2];
+
+    int north, south, west, east;
+
+    int size; // Global grid size
+    int i0, ni; // Global first row and number of rows owned by this rank
+    int j0, nj; // Global first column and number of columns owned by this rank
+
+    // Local grids of size (ni + 2) x (nj + 2), local (1, 1) is global (i0, j0)
+    Eigen::MatrixXd current_grid;
+    Eigen::MatrixXd next_grid;
+
+    // Rows are strided in column-major storage and are packed for sending
+    std::vector<double> send_north, send_south, recv_north, recv_south;
+
+    static void split(int n, int parts, int idx, int &first, int &count)
+    {
+        first = int((long long)n * idx / parts);
+        count = int((long long)n * (idx + 1) / parts) - first;
+    }
+
+    // Updates local rows [li0, li1) and columns [lj0, lj1), clipped to the
+    // global interior so that the fixed boundary values are never touched.
+    void update(int li0, int li1, int lj0, int lj1)
+    {
+        li0 = std::max(li0, 2 - i0);
+        li1 = std::min(li1, size - i0);
+        lj0 = std::max(lj0, 2 - j0);
+        lj1 = std::min(lj1, size - j0);
+
+        const int ld = ni + 2;
+        const double *cur = current_grid.data();
+        double *next = next_grid.data();
+
+#pragma omp parallel for schedule(static)
+        for (int j = lj0; j < lj1; j++)
+            StencilComputation::update_column(cur + (j - 1) * ld, cur + j * ld, cur + (j + 1) * ld, next + j * ld, li0,
+                                              li1);
+    }
+
+public:
+    DistributedStencil(int n, MPI_Comm comm) : size(n)
+    {
+        int nprocs;
+        MPI_Comm_size(comm, &nprocs);
+        MPI_Dims_create(nprocs, 2, dims);
+
+        int periods[2] = {0, 0};
+        MPI_Cart_create(comm, 2, dims, periods, 1, &cart);
+        MPI_Comm_rank(cart, &rank);
+        MPI_Cart_coords(cart, rank, 2, coords);
+
+        MPI_Cart_shift(cart, 0, 1, &north, &south);
+        MPI_Cart_shift(cart, 1, 1, &west, &east);
+
+        split(n, dims[0], coords[0], i0, ni);
+        split(n, dims[1], coords[1], j0, nj);
+
+        current_grid = Eigen::MatrixXd::Zero(ni + 2, nj + 2);
+        next_grid = Eigen::MatrixXd::Zero(ni + 2, nj + 2);
+
+        send_north.resize(nj);
+        send_south.resize(nj);
+        recv_north.resize(nj);
+        recv_south.resize(nj);
+    }
+
+    ~DistributedStencil()
+    {
+        MPI_Comm_free(&cart);
+    }
+
+    void initialize()
+    {
+        // Same initial and boundary conditions as StencilComputation
+
+        for (int lj = 1; lj <= nj; lj++)
+        {
+            for (int li = 1; li <= ni; li++)
+            {
+                int i = i0 + li - 1;
+                int j = j0 + lj - 1;
+
+                double value = 0.0;
+
+                if (i == 0)
+                    value = 100.0;
+                if (i == size - 1)
+                    value = 0.0;
+                if ((j == 0) || (j == size - 1))
+                    value = 50.0;
+
+                current_grid(li, lj) = value;
+                next_grid(li, lj) = value;
+            }
+        }
+    }
+
+    void step()
+    {
+        MPI_Request requests[8];
+
+        // West and east ghost columns are contiguous and received in place
+
+        MPI_Irecv(recv_north.data(), nj, MPI_DOUBLE, north, 0, cart, &requests[0]);
+        MPI_Irecv(recv_south.data(), nj, MPI_DOUBLE, south, 1, cart, &requests[1]);
+        MPI_Irecv(&current_grid(1, 0), ni, MPI_DOUBLE, west, 2, cart, &requests[2]);
+        MPI_Irecv(&current_grid(1, nj + 1), ni, MPI_DOUBLE, east, 3, cart, &requests[3]);
+
+        for (int j = 0; j < nj; j++)
+        {
+            send_north[j] = current_grid(1, j + 1);
+            send_south[j] = current_grid(ni, j + 1);
+        }
+
+        MPI_Isend(send_north.data(), nj, MPI_DOUBLE, north, 1, cart, &requests[4]);
+        MPI_Isend(send_south.data(), nj, MPI_DOUBLE, south, 0, cart, &requests[5]);
+        MPI_Isend(&current_grid(1, 1), ni, MPI_DOUBLE, west, 3, cart, &requests[6]);
+        MPI_Isend(&current_grid(1, nj), ni, MPI_DOUBLE, east, 2, cart, &requests[7]);
+
+        // Interior, overlapped with the halo exchange
+
+        update(2, ni, 2, nj);
+
+        MPI_Waitall(8, requests, MPI_STATUSES_IGNORE);
+
+        if (north != MPI_PROC_NULL)
+            for (int j = 0; j < nj; j++)
+                current_grid(0, j + 1) = recv_north[j];
+
+        if (south != MPI_PROC_NULL)
+            for (int j = 0; j < nj; j++)
+                current_grid(ni + 1, j + 1) = recv_south[j];
+
+        // Cells next to the ghost layer
+
+        update(1, 2, 1, nj + 1);
+        update(ni, ni + 1, 1, nj + 1);
+        update(2, ni, 1, 2);
+        update(2, ni, nj, nj + 1);
+
+        std::swap(current_grid, next_grid);
+    }
+
+    // Collects the global grid on rank 0. Other ranks return an empty matrix.
+    Eigen::MatrixXd gather() const
+    {
+        Eigen::MatrixXd local = current_grid.block(1, 1, ni, nj);
+
+        if (rank != 0)
+        {
+            int extent[4] = {i0, ni, j0, nj};
+            MPI_Send(extent, 4, MPI_INT, 0, 10, cart);
+            MPI_Send(local.data(), ni * nj, MPI_DOUBLE, 0, 11, cart);
+            return Eigen::MatrixXd();
+        }
+
+        int nprocs;
+        MPI_Comm_size(cart, &nprocs);
+
+        Eigen::MatrixXd grid(size, size);
+        grid.block(i0, j0, ni, nj) = local;
+
+        for (int r = 1; r < nprocs; r++)
+        {
+            int extent[4];
+            MPI_Recv(extent, 4, MPI_INT, r, 10, cart, MPI_STATUS_IGNORE);
+
+            Eigen::MatrixXd block(extent[1], extent[3]);
+            MPI_Recv(block.data(), extent[1] * extent[3], MPI_DOUBLE, r, 11, cart, MPI_STATUS_IGNORE);
+
+            grid.block(extent[0], extent[2], extent[1], extent[3]) = block;
+        }
+
+        return grid;
+    }
+
+    int get_rank() const
+    {
+        return rank;
+    }
+
+    int rows() const
+    {
+        return dims[0];
+    }
+
+    int cols() const
+    {
+        return dims[1];
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+
+    int N = 6000;        // Grid size
+    int max_iter = 100;  // Number of iterations
+    bool verify = false; // Gather on rank 0 and compare with a single-node run,
+                         // only for grids that fit in one node: halo_mpi1 N iter 1
+
+    if (argc > 1)
+        N = std::atoi(argv[1]);
+    if (argc > 2)
+        max_iter = std::atoi(argv[2]);
+    if (argc > 3)
+        verify = std::atoi(argv[3]) != 0;
+
+    {
+        DistributedStencil stencil(N, MPI_COMM_WORLD);
+        stencil.initialize();
+
+        if (stencil.get_rank() == 0)
+            std::cout << "Grid size " << N << " x " << N << ", " << max_iter << " iterations, " << stencil.rows()
+                      << " x " << stencil.cols() << " ranks\n";
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start_time = MPI_Wtime();
+
+        for (int iter = 0; iter < max_iter; iter++)
+            stencil.step();
+
+        double elapsed = MPI_Wtime() - start_time;
+        double max_elapsed;
+        MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        if (stencil.get_rank() == 0)
+        {
+            double updates = double(N - 2) * double(N - 2) * max_iter;
+            std::cout << "Computation took " << max_elapsed << " seconds, " << updates / max_elapsed / 1e9
+                      << " GLUP/s\n";
+        }
+
+        if (verify)
+        {
+            Eigen::MatrixXd grid = stencil.gather();
+
+            if (stencil.get_rank() == 0)
+            {
+                StencilComputation reference(N);
+                reference.initialize();
+
+                for (int iter = 0; iter < max_iter; iter++)
+                    reference.step_blocked();
+
+                // Corners are never read by the stencil and are left out
+
+                bool identical =
+                    (grid.block(1, 0, N - 2, N) == reference.grid().block(1, 0, N - 2, N)) &&
+                    (grid.block(0, 1, N, N - 2) == reference.grid().block(0, 1, N, N - 2));
+
+                std::cout << "Bit-identical to single-node run: " << (identical ? "yes" : "no") << "\n";
+            }
+        }
+    }
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+
+// Bounded multi-producer/multi-consumer queue with the same push/pop/finish
+// interface as SafeQueue, built on a lock-free ring buffer (Dmitry Vyukov's
+// bounded MPMC queue). Every cell carries a sequence number that tells
+// producers and consumers whether the cell is free or holds data for the
+// current lap, so a push or pop is a single compare-and-swap on the head or
+// tail counter. The counters live on separate cache lines.
+//
+// Blocking push and pop spin for a short while, then yield for a while and
+// finally park on an atomic counter (C++20 atomic wait/notify), so no thread
+// ever sleeps while holding a lock.
+
+template < typename T > class LockFreeQueue {
+private:
+    static constexpr std::size_t cacheLine = 64;
+    static constexpr int spinCount = 64;
+    static constexpr int yieldCount = 64;
+
+    struct Cell {
+        std::atomic< std::size_t > sequence;
+        T data;
+    };
+
+    std::unique_ptr< Cell[] > m_cells;
+    std::size_t m_mask;
+
+    alignas(cacheLine) std::atomic< std::size_t > m_enqueuePos{0};
+    alignas(cacheLine) std::atomic< std::size_t > m_dequeuePos{0};
+
+    // Parking: consumers wait on m_pushCount, producers on m_popCount. The
+    // waiter counts let the other side skip the notify when nobody sleeps.
+    alignas(cacheLine) std::atomic< std::uint32_t > m_pushCount{0};
+    std::atomic< int > m_waitingConsumers{0};
+    alignas(cacheLine) std::atomic< std::uint32_t > m_popCount{0};
+    std::atomic< int > m_waitingProducers{0};
+
+    alignas(cacheLine) std::atomic< bool > m_finished{false};
+
+    static std::size_t roundUpPow2(std::size_t n)
+    {
+        std::size_t capacity = 2;
+        while (capacity < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    // The fence orders the preceding push/pop before the waiter check. A
+    // thread that registers as waiter afterwards is guaranteed to see the
+    // change in its last try before parking, so the shared counter is only
+    // touched when somebody actually sleeps.
+    void wakeConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waitingConsumers.load(std::memory_order_relaxed) > 0)
+        {
+            m_pushCount.fetch_add(1);
+            m_pushCount.notify_one();
+        }
+    }
+
+    void wakeProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waitingProducers.load(std::memory_order_relaxed) > 0)
+        {
+            m_popCount.fetch_add(1);
+            m_popCount.notify_one();
+        }
+    }
+
+public:
+    // Capacity is rounded up to the next power of two
+    LockFreeQueue(std::size_t maxSize = 10) : m_mask(roundUpPow2(maxSize) - 1)
+    {
+        m_cells = std::make_unique< Cell[] >(m_mask + 1);
+
+        for (std::size_t i = 0; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Non-blocking push, returns false if the queue is full
+    bool tryPush(T &item)
+    {
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell &cell = m_cells[pos & m_mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+
+            if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // Full
+            else
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Non-blocking pop, returns std::nullopt if the queue is empty
+    std::optional< T > tryPop()
+    {
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell &cell = m_cells[pos & m_mask];
+            std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+
+            if (diff == 0)
+            {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    T item = std::move(cell.data);
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return item;
+                }
+            }
+            else if (diff < 0)
+                return std::nullopt; // Empty
+            else
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Producer: Add item to queue (blocks if full)
+    void push(T item)
+    {
+        for (int spin = 0; !m_finished.load(std::memory_order_relaxed); ++spin)
+        {
+            if (tryPush(item))
+            {
+                wakeConsumer();
+                return;
+            }
+
+            if (spin < spinCount)
+                continue;
+
+            if (spin < spinCount + yieldCount)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Park until a consumer has removed an item or finish() is called
+
+            m_waitingProducers.fetch_add(1);
+            std::uint32_t count = m_popCount.load();
+
+            if (tryPush(item))
+            {
+                m_waitingProducers.fetch_sub(1);
+                wakeConsumer();
+                return;
+            }
+
+            if (!m_finished.load())
+                m_popCount.wait(count);
+
+            m_waitingProducers.fetch_sub(1);
+        }
+    }
+
+    // Consumer: Remove item from queue (blocks if empty)
+    std::optional< T > pop()
+    {
+        for (int spin = 0;; ++spin)
+        {
+            if (auto item = tryPop())
+            {
+                wakeProducer();
+                return item;
+            }
+
+            if (m_finished.load())
+            {
+                // Items pushed before finish() are still delivered
+                if (auto item = tryPop())
+                    return item;
+                return std::nullopt; // No more data
+            }
+
+            if (spin < spinCount)
+                continue;
+
+            if (spin < spinCount + yieldCount)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Park until a producer has added an item or finish() is called
+
+            m_waitingConsumers.fetch_add(1);
+            std::uint32_t count = m_pushCount.load();
+
+            if (auto item = tryPop())
+            {
+                m_waitingConsumers.fetch_sub(1);
+                wakeProducer();
+                return item;
+            }
+
+            if (!m_finished.load())
+                m_pushCount.wait(count);
+
+            m_waitingConsumers.fetch_sub(1);
+        }
+    }
+
+    // Signal that no more items will be produced
+    void finish()
+    {
+        m_finished.store(true);
+        m_pushCount.fetch_add(1);
+        m_popCount.fetch_add(1);
+        m_pushCount.notify_all(); // Wake all waiting threads
+        m_popCount.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::size_t tail = m_dequeuePos.load();
+        std::size_t head = m_enqueuePos.load();
+        return head > tail ? head - tail : 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+};
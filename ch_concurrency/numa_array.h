@@ -0,0 +1,501 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// NUMA aware arrays and pinned threads. On a machine with several memory
+// nodes a page is placed on the node of the thread that first writes it,
+// and every access from a thread on another node goes over the socket
+// interconnect. To keep accesses local three things have to agree:
+//
+//   1. The array is divided into one contiguous chunk per thread with
+//      chunkBegin(), and every pass over it uses the same division.
+//   2. PinnedTeam thread t always runs on the same CPU (sched_setaffinity),
+//      threads with neighbouring chunks on the same node.
+//   3. numa::Array binds the pages of chunk t to the node of thread t and
+//      has thread t write them first.
+//
+// Placement::INTERLEAVED spreads the pages round robin over all nodes
+// instead, which is what an unpinned program gets on average.
+//
+// The topology is read from /sys without libnuma and the memory policy is
+// set with the mbind system call. On a single node nothing is bound, and if
+// the system calls are refused the threads stay unpinned and the pages go
+// wherever first touch puts them. Other operating systems get ordinary
+// allocations and unpinned threads, so the examples run unchanged.
+
+namespace numa
+{
+
+enum class Placement
+{
+    LOCAL,
+    INTERLEAVED
+};
+
+struct Topology {
+    std::vector< int > cpus;  // Usable CPUs, ordered by node
+    std::vector< int > nodes; // Node of each entry in cpus
+    int nodeCount = 1;
+};
+
+namespace detail
+{
+
+#ifdef __linux__
+
+// Memory policies from <numaif.h>
+constexpr int mpolPreferred = 1;
+constexpr int mpolInterleave = 3;
+
+// Parses a list like "0-3,8-11"
+inline std::vector< int > parseCpuList(const std::string &list)
+{
+    std::vector< int > cpus;
+    std::size_t pos = 0;
+
+    while (pos < list.size())
+    {
+        std::size_t next = list.find(',', pos);
+        std::string item = list.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        std::size_t dash = item.find('-');
+
+        try
+        {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        catch (const std::exception &)
+        {
+        }
+
+        if (next == std::string::npos)
+            break;
+
+        pos = next + 1;
+    }
+
+    return cpus;
+}
+
+inline Topology readTopology()
+{
+    Topology topology;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        int count = std::max(1, int(std::thread::hardware_concurrency()));
+        for (int cpu = 0; (cpu < count) && (cpu < CPU_SETSIZE); ++cpu)
+            CPU_SET(cpu, &allowed);
+    }
+
+    std::vector< int > nodeIds;
+
+    if (DIR *dir = opendir("/sys/devices/system/node"))
+    {
+        while (dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+
+            if ((name.size() > 4) && (name.compare(0, 4, "node") == 0) &&
+                (name.find_first_not_of("0123456789", 4) == std::string::npos))
+                nodeIds.push_back(std::stoi(name.substr(4)));
+        }
+
+        closedir(dir);
+    }
+
+    std::sort(nodeIds.begin(), nodeIds.end());
+
+    for (int node : nodeIds)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        for (int cpu : parseCpuList(list))
+        {
+            if ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &allowed))
+            {
+                topology.cpus.push_back(cpu);
+                topology.nodes.push_back(node);
+            }
+        }
+    }
+
+    if (topology.cpus.empty())
+    {
+        // No node information, one node with all allowed CPUs
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                topology.cpus.push_back(cpu);
+                topology.nodes.push_back(0);
+            }
+        }
+    }
+
+    std::vector< int > distinct = topology.nodes;
+    std::sort(distinct.begin(), distinct.end());
+    topology.nodeCount = int(std::unique(distinct.begin(), distinct.end()) - distinct.begin());
+
+    return topology;
+}
+
+// Sets the policy of the pages in [begin, end), rounded outwards to pages
+inline bool bind(void *begin, void *end, int policy, const std::vector< int > &nodes)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+
+    auto first = reinterpret_cast< std::uintptr_t >(begin) & ~std::uintptr_t(pageSize - 1);
+    auto last = (reinterpret_cast< std::uintptr_t >(end) + pageSize - 1) & ~std::uintptr_t(pageSize - 1);
+
+    if (first >= last)
+        return true;
+
+    constexpr std::size_t wordBits = 8 * sizeof(unsigned long);
+
+    int maxNode = *std::max_element(nodes.begin(), nodes.end());
+    std::vector< unsigned long > mask(maxNode / wordBits + 1, 0);
+
+    for (int node : nodes)
+        mask[node / wordBits] |= 1UL << (node % wordBits);
+
+    return syscall(SYS_mbind, first, last - first, policy, mask.data(), mask.size() * wordBits + 1, 0) == 0;
+}
+
+#endif
+
+} // namespace detail
+
+// Read once, restricted to the CPUs this process may run on
+inline const Topology &topology()
+{
+#ifdef __linux__
+    static const Topology topology = detail::readTopology();
+#else
+    static const Topology topology = []() {
+        Topology t;
+        int count = std::max(1, int(std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu)
+        {
+            t.cpus.push_back(cpu);
+            t.nodes.push_back(0);
+        }
+        return t;
+    }();
+#endif
+    return topology;
+}
+
+// Chunk part of [0, size) divided in parts, as [begin, end)
+inline std::size_t chunkBegin(std::size_t size, int part, int parts)
+{
+    return size * std::size_t(part) / std::size_t(parts);
+}
+
+// Threads with fixed CPUs and fixed chunks. Thread t of parallelFor() and
+// parallelReduce() always runs on cpu(t) and always gets chunk t. The
+// workers are created and pinned once and sleep on an atomic between loops,
+// as in ThreadPool, so a loop costs a wake-up instead of creating threads.
+class PinnedTeam {
+private:
+    static constexpr int spinCount = 1024;
+
+    int m_threads;
+    std::vector< std::jthread > m_workers;
+
+    // Current loop, published by incrementing m_generation
+    void (*m_run)(void *state, int t) = nullptr;
+    void *m_state = nullptr;
+
+    std::mutex m_callMutex; // One loop at a time
+    alignas(64) std::atomic< std::uint32_t > m_generation{0};
+    alignas(64) std::atomic< int > m_remaining{0};
+    std::atomic< bool > m_stop{false};
+
+    void pin(int t) const
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu(t), &set);
+        sched_setaffinity(0, sizeof(set), &set); // Failure leaves the thread unpinned
+#else
+        (void)t;
+#endif
+    }
+
+    void workerLoop(int t)
+    {
+        pin(t);
+
+        std::uint32_t seen = 0;
+
+        while (true)
+        {
+            for (int spin = 0; (spin < spinCount) && (m_generation.load(std::memory_order_acquire) == seen); ++spin)
+                std::this_thread::yield();
+
+            m_generation.wait(seen, std::memory_order_acquire);
+            seen = m_generation.load(std::memory_order_acquire);
+
+            if (m_stop.load())
+                return;
+
+            m_run(m_state, t);
+
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                m_remaining.notify_one();
+        }
+    }
+
+    // Runs fn(t) on every worker and returns when all have finished
+    template < typename Fn > void run(Fn &fn)
+    {
+        std::lock_guard< std::mutex > lock(m_callMutex);
+
+        m_run = [](void *state, int t) { (*static_cast< Fn * >(state))(t); };
+        m_state = &fn;
+        m_remaining.store(m_threads, std::memory_order_relaxed);
+
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_generation.notify_all();
+
+        for (int remaining = m_remaining.load(std::memory_order_acquire); remaining != 0;
+             remaining = m_remaining.load(std::memory_order_acquire))
+            m_remaining.wait(remaining, std::memory_order_acquire);
+    }
+
+public:
+    // 0 uses all CPUs the process may run on
+    explicit PinnedTeam(int threads = 0)
+        : m_threads(threads > 0 ? threads : int(topology().cpus.size()))
+    {
+        m_workers.reserve(m_threads);
+
+        for (int t = 0; t < m_threads; ++t)
+            m_workers.emplace_back([this, t]() { workerLoop(t); });
+    }
+
+    ~PinnedTeam()
+    {
+        m_stop.store(true);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_generation.notify_all();
+        m_workers.clear(); // Joins
+    }
+
+    PinnedTeam(const PinnedTeam &) = delete;
+    PinnedTeam &operator=(const PinnedTeam &) = delete;
+
+    int size() const
+    {
+        return m_threads;
+    }
+
+    // Threads are spread evenly over the CPUs, which are ordered by node, so
+    // neighbouring threads share a node
+    int cpuIndex(int t) const
+    {
+        int cpus = int(topology().cpus.size());
+        return m_threads <= cpus ? int(std::size_t(t) * cpus / m_threads) : t % cpus;
+    }
+
+    int cpu(int t) const
+    {
+        return topology().cpus[cpuIndex(t)];
+    }
+
+    int node(int t) const
+    {
+        return topology().nodes[cpuIndex(t)];
+    }
+
+    // Calls fn(begin, end) for chunk t of [0, size) on thread t. Loops from
+    // several threads run one after the other, fn must not start another
+    // loop on the same team.
+    template < typename Fn > void parallelFor(std::size_t size, Fn &&fn)
+    {
+        auto chunk = [this, size, &fn](int t) {
+            fn(chunkBegin(size, t, m_threads), chunkBegin(size, t + 1, m_threads));
+        };
+
+        run(chunk);
+    }
+
+    // Combines map(begin, end) of the chunks in chunk order, so the result
+    // only depends on the team size
+    template < typename T, typename Map, typename Combine >
+    T parallelReduce(std::size_t size, T init, Map &&map, Combine &&combine)
+    {
+        std::vector< T > partial(m_threads, init);
+
+        auto chunk = [this, size, &map, &partial](int t) {
+            partial[t] = map(chunkBegin(size, t, m_threads), chunkBegin(size, t + 1, m_threads));
+        };
+
+        run(chunk);
+
+        T result = init;
+
+        for (const T &value : partial)
+            result = combine(result, value);
+
+        return result;
+    }
+};
+
+// Array of trivial elements with pages placed for a PinnedTeam. The
+// elements are initialised to value by the team, which also makes the
+// first touch place the pages when binding is not possible.
+template < typename T > class Array {
+private:
+    static_assert(std::is_trivially_copyable_v< T > && std::is_trivially_destructible_v< T >,
+                  "numa::Array holds trivial elements");
+
+    T *m_data = nullptr;
+    std::size_t m_size = 0;
+    std::size_t m_bytes = 0;
+
+public:
+    Array(PinnedTeam &team, std::size_t size, Placement placement, T value = T{})
+        : m_size(size)
+    {
+        m_bytes = std::max< std::size_t >(1, size * sizeof(T));
+
+#ifdef __linux__
+        void *memory = mmap(nullptr, m_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc();
+
+        m_data = static_cast< T * >(memory);
+
+        // Only the policy is set here, no page exists before the first touch
+
+        const Topology &topo = topology();
+
+        if (topo.nodeCount > 1)
+        {
+            if (placement == Placement::INTERLEAVED)
+            {
+                detail::bind(m_data, m_data + size, detail::mpolInterleave, topo.nodes);
+            }
+            else
+            {
+                for (int t = 0; t < team.size(); ++t)
+                {
+                    T *begin = m_data + chunkBegin(size, t, team.size());
+                    T *end = m_data + chunkBegin(size, t + 1, team.size());
+                    detail::bind(begin, end, detail::mpolPreferred, {team.node(t)});
+                }
+            }
+        }
+#else
+        (void)placement;
+        m_data = static_cast< T * >(::operator new(m_bytes, std::align_val_t(64)));
+#endif
+
+        team.parallelFor(size, [this, value](std::size_t begin, std::size_t end) {
+            std::fill(m_data + begin, m_data + end, value);
+        });
+    }
+
+    ~Array()
+    {
+#ifdef __linux__
+        munmap(m_data, m_bytes);
+#else
+        ::operator delete(m_data, std::align_val_t(64));
+#endif
+    }
+
+    Array(const Array &) = delete;
+    Array &operator=(const Array &) = delete;
+
+    T *data()
+    {
+        return m_data;
+    }
+
+    const T *data() const
+    {
+        return m_data;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    T &operator[](std::size_t i)
+    {
+        return m_data[i];
+    }
+
+    const T &operator[](std::size_t i) const
+    {
+        return m_data[i];
+    }
+
+    // Number of pages on each node, for at most samples pages spread over
+    // the array. Empty where the kernel cannot report it.
+    std::vector< std::size_t > pagesPerNode(std::size_t samples = 4096) const
+    {
+        std::vector< std::size_t > counts;
+
+#ifdef __linux__
+        long pageSize = sysconf(_SC_PAGESIZE);
+        std::size_t pages = (m_bytes + pageSize - 1) / pageSize;
+        std::size_t stride = std::max< std::size_t >(1, pages / samples);
+
+        std::vector< void * > addresses;
+
+        for (std::size_t p = 0; p < pages; p += stride)
+            addresses.push_back(reinterpret_cast< char * >(m_data) + p * pageSize);
+
+        std::vector< int > status(addresses.size(), -1);
+
+        if (syscall(SYS_move_pages, 0, addresses.size(), addresses.data(), nullptr, status.data(), 0) != 0)
+            return counts;
+
+        const std::vector< int > &nodes = topology().nodes;
+        counts.resize(nodes.empty() ? 1 : *std::max_element(nodes.begin(), nodes.end()) + 1);
+
+        for (int node : status)
+            if ((node >= 0) && (node < int(counts.size())))
+                ++counts[node];
+#endif
+
+        return counts;
+    }
+};
+
+} // namespace numa
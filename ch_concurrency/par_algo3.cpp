@@ -1,15 +1,165 @@
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <execution>
 #include <print>
 #include <random>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-int main()
+#include "radix_sort.h"
+
+// Usage:
+//
+//   par_algo3            sort 100M ints with std::sort (par and seq) and radix::sort
+//   par_algo3 --bench N  compare the sorts for sizes up to N (default 10M)
+//                        and several key distributions
+
+enum class Distribution
+{
+    UNIFORM,
+    SORTED,
+    REVERSED,
+    FEW_UNIQUE
+};
+
+constexpr std::string_view distributionName(Distribution distribution)
+{
+    switch (distribution)
+    {
+    case Distribution::UNIFORM:
+        return "uniform";
+    case Distribution::SORTED:
+        return "sorted";
+    case Distribution::REVERSED:
+        return "reversed";
+    case Distribution::FEW_UNIQUE:
+        return "few unique";
+    }
+    return "";
+}
+
+template < typename Key > std::vector< Key > makeKeys(std::size_t n, Distribution distribution)
+{
+    std::vector< Key > keys(n);
+
+    std::mt19937_64 gen(42); // Fixed seed for reproducibility
+
+    if (distribution == Distribution::FEW_UNIQUE)
+    {
+        std::uniform_int_distribution< Key > dis(0, 15);
+        std::generate(keys.begin(), keys.end(), [&]() { return Key(dis(gen) * 1000003); });
+        return keys;
+    }
+
+    std::uniform_int_distribution< Key > dis;
+    std::generate(keys.begin(), keys.end(), [&]() { return dis(gen); });
+
+    if (distribution == Distribution::SORTED)
+        std::sort(std::execution::par, keys.begin(), keys.end());
+    else if (distribution == Distribution::REVERSED)
+        std::sort(std::execution::par, keys.begin(), keys.end(), std::greater< Key >());
+
+    return keys;
+}
+
+template < typename Fn > double timeIt(Fn &&fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration< double >(end - start).count();
+}
+
+// Times std::sort (seq and par) and radix::sort on copies of the same keys
+template < typename Key > void benchKeys(std::string_view typeName, std::size_t n, Distribution distribution)
 {
+    const std::vector< Key > keys = makeKeys< Key >(n, distribution);
+
+    std::vector< Key > seqData = keys;
+    std::vector< Key > parData = keys;
+    std::vector< Key > radixData = keys;
+
+    double seqTime = timeIt([&]() { std::sort(std::execution::seq, seqData.begin(), seqData.end()); });
+    double parTime = timeIt([&]() { std::sort(std::execution::par, parData.begin(), parData.end()); });
+    double radixTime = timeIt([&]() { radix::sort(radixData); });
+
+    bool ok = (parData == seqData) && (radixData == seqData);
+
+    std::print("{:<10} {:>10} {:<11} {:>10.4f} {:>10.4f} {:>10.4f} {:>8.2f}x {}\n", typeName, n,
+               distributionName(distribution), seqTime, parTime, radixTime, parTime / radixTime, ok ? "" : "FAILED");
+}
+
+// Key-value pairs: std::stable_sort on pairs compared by key against
+// radix::sort on separate key and value arrays. Both are stable, so the
+// results must be identical.
+void benchPairs(std::size_t n, Distribution distribution)
+{
+    std::vector< std::uint64_t > keys = makeKeys< std::uint64_t >(n, distribution);
+    std::vector< std::uint32_t > values(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+        values[i] = std::uint32_t(i);
+
+    std::vector< std::pair< std::uint64_t, std::uint32_t > > seqData(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+        seqData[i] = {keys[i], values[i]};
+
+    auto parData = seqData;
+
+    auto byKey = [](const auto &a, const auto &b) { return a.first < b.first; };
+
+    double seqTime = timeIt([&]() { std::stable_sort(std::execution::seq, seqData.begin(), seqData.end(), byKey); });
+    double parTime = timeIt([&]() { std::stable_sort(std::execution::par, parData.begin(), parData.end(), byKey); });
+    double radixTime = timeIt([&]() { radix::sort(keys, values); });
+
+    bool ok = parData == seqData;
+
+    for (std::size_t i = 0; ok && (i < n); ++i)
+        ok = (keys[i] == seqData[i].first) && (values[i] == seqData[i].second);
+
+    std::print("{:<10} {:>10} {:<11} {:>10.4f} {:>10.4f} {:>10.4f} {:>8.2f}x {}\n", "u64+u32", n,
+               distributionName(distribution), seqTime, parTime, radixTime, parTime / radixTime, ok ? "" : "FAILED");
+}
+
+void benchmark(std::size_t maxSize)
+{
+    constexpr Distribution distributions[] = {Distribution::UNIFORM, Distribution::SORTED, Distribution::REVERSED,
+                                              Distribution::FEW_UNIQUE};
+
+    std::print("Threads: {}\n\n", ThreadPool::global().size());
+    std::print("{:<10} {:>10} {:<11} {:>10} {:>10} {:>10} {:>9}\n", "Keys", "Size", "Input", "seq [s]", "par [s]",
+               "radix [s]", "par/radix");
+
+    for (std::size_t n = 100000; n <= maxSize; n *= 10)
+    {
+        for (Distribution distribution : distributions)
+        {
+            benchKeys< std::int32_t >("i32", n, distribution);
+            benchKeys< std::uint32_t >("u32", n, distribution);
+            benchKeys< std::int64_t >("i64", n, distribution);
+            benchKeys< std::uint64_t >("u64", n, distribution);
+            benchPairs(n, distribution);
+        }
+        std::print("\n");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc > 1) && (std::string_view(argv[1]) == "--bench"))
+    {
+        benchmark(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000);
+        return 0;
+    }
+
     const int N = 100000000;
     std::vector< int > parData(N);
     std::vector< int > seqData(N);
+    std::vector< int > radixData(N);
 
     // Initialize the vector with some values
 
@@ -19,6 +169,7 @@ int main()
     std::uniform_int_distribution<> dis(1, N);
     std::generate(parData.begin(), parData.end(), [&]() { return dis(gen); });
     std::copy(parData.begin(), parData.end(), seqData.begin());
+    std::copy(parData.begin(), parData.end(), radixData.begin());
 
     std::print("Starting sort operations...\n");
 
@@ -34,6 +185,12 @@ int main()
     auto endSeq = std::chrono::high_resolution_clock::now();
     std::chrono::duration< double > durationSeq = endSeq - startSeq;
 
+    // Parallel radix sort
+    auto startRadix = std::chrono::high_resolution_clock::now();
+    radix::sort(radixData);
+    auto endRadix = std::chrono::high_resolution_clock::now();
+    std::chrono::duration< double > durationRadix = endRadix - startRadix;
+
     // Check if sort opereration was successful
 
     std::print("Verifying sorted data...\n");
@@ -44,9 +201,13 @@ int main()
     std::is_sorted(std::execution::par, seqData.begin(), seqData.end()) ? std::print("Sequential sort successful.\n")
                                                                         : std::print("Sequential sort failed.\n");
 
+    radixData == seqData ? std::print("Radix sort successful.\n") : std::print("Radix sort failed.\n");
+
     std::print("Parallel sort time: {} seconds\n", durationPar.count());
     std::print("Sequential sort time: {} seconds\n", durationSeq.count());
+    std::print("Radix sort time: {} seconds\n", durationRadix.count());
     std::print("Speedup: {:.2f}x\n", durationSeq.count() / durationPar.count());
+    std::print("Radix speedup: {:.2f}x\n", durationSeq.count() / durationRadix.count());
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <chrono>
 #include <print>
 #include <random>
+#include <span>
+#include <string>
 #include <thread>
 
+#include "lock_free_queue.h"
 #include "safe_queue.h"
 
 void producer(SafeQueue< int > &queue, int id, int itemCount)
@@ -45,8 +49,111 @@ void consumer(SafeQueue< int > &queue, int id, std::atomic< int > &totalConsumed
     }
 }
 
-int main()
+// Moves totalItems integers from numProducers to numConsumers threads
+// through a queue and returns the throughput in items/s. With Batch > 1 the
+// items are transferred with push_bulk/pop_bulk in batches of that size.
+template < typename Queue, int Batch = 1 >
+double throughput(int numProducers, int numConsumers, int totalItems, size_t capacity)
 {
+    Queue queue(capacity);
+    std::atomic< long long > totalConsumed{0};
+
+    int itemsPerProducer = totalItems / numProducers;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    {
+        std::vector< std::jthread > consumers;
+        for (int i = 0; i < numConsumers; ++i)
+            consumers.emplace_back([&queue, &totalConsumed]() {
+                long long count = 0;
+                if constexpr (Batch > 1)
+                {
+                    std::vector< int > items(Batch);
+                    while (size_t n = queue.pop_bulk(items))
+                        count += n;
+                }
+                else
+                {
+                    while (queue.pop().has_value())
+                        count++;
+                }
+                totalConsumed += count;
+            });
+
+        std::vector< std::jthread > producers;
+        for (int i = 0; i < numProducers; ++i)
+            producers.emplace_back([&queue, itemsPerProducer]() {
+                if constexpr (Batch > 1)
+                {
+                    std::vector< int > items(Batch);
+                    for (int j = 0; j < itemsPerProducer; j += Batch)
+                    {
+                        int n = std::min(Batch, itemsPerProducer - j);
+                        for (int k = 0; k < n; ++k)
+                            items[k] = j + k;
+                        queue.push_bulk(std::span< int >(items.data(), n));
+                    }
+                }
+                else
+                {
+                    for (int j = 0; j < itemsPerProducer; ++j)
+                        queue.push(j);
+                }
+            });
+
+        producers.clear();
+        queue.finish();
+        consumers.clear();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsed = end - start;
+
+    return totalConsumed.load() / elapsed.count();
+}
+
+void benchmark()
+{
+    const int totalItems = 2000000;
+    const size_t capacity = 1024;
+    constexpr int batch = 64;
+
+    std::println("Throughput, {} items, capacity {}, batch size {}\n", totalItems, capacity, batch);
+    std::println("{:>8} {:>16} {:>16} {:>16}", "threads", "SafeQueue [M/s]", "bulk [M/s]", "LockFree [M/s]");
+
+    // Same number of producer and consumer threads
+
+    for (int threads : {1, 2, 4, 8, 16})
+    {
+        double safe = throughput< SafeQueue< int > >(threads, threads, totalItems, capacity);
+        double bulk = throughput< SafeQueue< int >, batch >(threads, threads, totalItems, capacity);
+        double lockFree = throughput< LockFreeQueue< int > >(threads, threads, totalItems, capacity);
+
+        std::println("{:>8} {:>16.2f} {:>16.2f} {:>16.2f}", threads, safe / 1e6, bulk / 1e6, lockFree / 1e6);
+    }
+
+    // The SPSC specialization only supports one thread per side
+
+    using SpscQueue = SafeQueue< int, QueueMode::SPSC >;
+
+    double spsc = throughput< SpscQueue >(1, 1, totalItems, capacity);
+    double spscBulk = throughput< SpscQueue, batch >(1, 1, totalItems, capacity);
+
+    std::println("\nSPSC, 1 producer, 1 consumer: {:.2f} M/s, bulk {:.2f} M/s", spsc / 1e6, spscBulk / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+    // Run "producer_consumer --bench" for the queue throughput comparison
+
+    if ((argc > 1) && (std::string(argv[1]) == "--bench"))
+    {
+        benchmark();
+        return 0;
+    }
+
     const int numProducers = 3;
     const int numConsumers = 2;
     const int itemsPerProducer = 5;
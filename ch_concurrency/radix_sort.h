@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Parallel least significant digit radix sort for 32 and 64 bit integer
+// keys, optionally carrying a value per key. Keys are sorted one 8 bit
+// digit per pass, so 4 passes for 32 bit and 8 passes for 64 bit keys, each
+// reading and writing the data once regardless of its order. Every pass:
+//
+//   1. Each thread counts the digits of its contiguous chunk (a 256 entry
+//      histogram that stays in L1).
+//   2. An exclusive prefix sum over digit, then thread, gives every thread
+//      its own output position per digit. This keeps the sort stable.
+//   3. Each thread scatters its chunk to those positions.
+//
+// A pass is skipped when all keys share the same digit, so small key ranges
+// and few unique values need fewer passes. Signed keys are sorted by
+// flipping the sign bit. Uses a buffer of the same size as the input.
+
+namespace radix
+{
+
+constexpr int digitBits = 8;
+constexpr std::size_t buckets = std::size_t(1) << digitBits;
+
+namespace detail
+{
+
+template < typename Key > auto ordered(Key key)
+{
+    using U = std::make_unsigned_t< Key >;
+
+    U u = static_cast< U >(key);
+
+    if constexpr (std::is_signed_v< Key >)
+        u ^= U(1) << (sizeof(Key) * CHAR_BIT - 1);
+
+    return u;
+}
+
+// Sorts keys, with values moved along unless Value is std::nullptr_t. keys and
+// values are the input and hold the result, keyBuffer and valueBuffer are
+// scratch space of the same size.
+template < typename Key, typename Value >
+void sort(ThreadPool &pool, std::span< Key > keys, std::span< Key > keyBuffer, Value *values, Value *valueBuffer)
+{
+    static_assert(std::is_integral_v< Key > && (sizeof(Key) == 4 || sizeof(Key) == 8),
+                  "radix::sort supports 32 and 64 bit integer keys");
+
+    constexpr bool hasValues = !std::is_same_v< Value, std::nullptr_t >;
+    constexpr int passes = int(sizeof(Key)) * CHAR_BIT / digitBits;
+
+    const std::size_t n = keys.size();
+
+    if (n < 2)
+        return;
+
+    // At least 64k keys per thread, fewer keys do not pay for the threads
+    const std::size_t threads = std::min< std::size_t >(std::size_t(pool.size()), n / 65536 + 1);
+
+    std::vector< std::array< std::size_t, buckets > > histogram(threads);
+
+    Key *src = keys.data();
+    Key *dst = keyBuffer.data();
+    Value *srcValues = values;
+    Value *dstValues = valueBuffer;
+
+    auto chunkBegin = [n, threads](std::size_t t) { return n * t / threads; };
+
+    auto forEachThread = [&](auto &&fn) {
+        pool.parallelFor(0, threads, 1, [&](std::size_t first, std::size_t last) {
+            for (std::size_t t = first; t < last; ++t)
+                fn(t, chunkBegin(t), chunkBegin(t + 1));
+        });
+    };
+
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        const int shift = pass * digitBits;
+
+        forEachThread([&](std::size_t t, std::size_t begin, std::size_t end) {
+            auto &count = histogram[t];
+            count.fill(0);
+
+            for (std::size_t i = begin; i < end; ++i)
+                ++count[(ordered(src[i]) >> shift) & (buckets - 1)];
+        });
+
+        // Offsets, digit major so equal digits keep their order across chunks
+
+        bool skip = false;
+        std::size_t offset = 0;
+
+        for (std::size_t d = 0; d < buckets; ++d)
+        {
+            std::size_t total = 0;
+
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                std::size_t count = histogram[t][d];
+                histogram[t][d] = offset + total;
+                total += count;
+            }
+
+            if (total == n)
+                skip = true;
+
+            offset += total;
+        }
+
+        if (skip)
+            continue;
+
+        forEachThread([&](std::size_t t, std::size_t begin, std::size_t end) {
+            auto &position = histogram[t];
+
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::size_t p = position[(ordered(src[i]) >> shift) & (buckets - 1)]++;
+                dst[p] = src[i];
+
+                if constexpr (hasValues)
+                    dstValues[p] = std::move(srcValues[i]);
+            }
+        });
+
+        std::swap(src, dst);
+
+        if constexpr (hasValues)
+            std::swap(srcValues, dstValues);
+    }
+
+    // After an odd number of passes the result is in the buffer
+
+    if (src != keys.data())
+    {
+        forEachThread([&](std::size_t, std::size_t begin, std::size_t end) {
+            std::copy(src + begin, src + end, keys.data() + begin);
+
+            if constexpr (hasValues)
+                std::move(srcValues + begin, srcValues + end, values + begin);
+        });
+    }
+}
+
+} // namespace detail
+
+// Sorts keys in ascending order
+template < typename Key > void sort(std::span< Key > keys, ThreadPool &pool = ThreadPool::global())
+{
+    std::vector< Key > buffer(keys.size());
+    detail::sort< Key, std::nullptr_t >(pool, keys, buffer, nullptr, nullptr);
+}
+
+template < typename Key > void sort(std::vector< Key > &keys, ThreadPool &pool = ThreadPool::global())
+{
+    sort(std::span< Key >(keys), pool);
+}
+
+// Sorts keys in ascending order and values[i] along with keys[i]. Stable,
+// values with equal keys keep their order. Arrays of different sizes are
+// left unchanged.
+template < typename Key, typename Value >
+void sort(std::span< Key > keys, std::span< Value > values, ThreadPool &pool = ThreadPool::global())
+{
+    assert(keys.size() == values.size());
+
+    if (keys.size() != values.size())
+        return;
+
+    std::vector< Key > keyBuffer(keys.size());
+    std::vector< Value > valueBuffer(values.size());
+    detail::sort< Key, Value >(pool, keys, keyBuffer, values.data(), valueBuffer.data());
+}
+
+template < typename Key, typename Value >
+void sort(std::vector< Key > &keys, std::vector< Value > &values, ThreadPool &pool = ThreadPool::global())
+{
+    sort(std::span< Key >(keys), std::span< Value >(values), pool);
+}
+
+} // namespace radix
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Floating point addition is not associative, so a parallel sum normally
+// depends on how the work was split and in which order the partial sums
+// arrived. The reductions here always add in the same order:
+//
+//   1. The range is divided into blocks of a fixed size, independent of the
+//      number of threads. Each block is summed sequentially in index order.
+//   2. The block sums are stored by block index and combined with a pairwise
+//      tree whose shape only depends on the number of blocks.
+//
+// The threads only decide who computes which block, never the order of the
+// additions, so the result is bit for bit the same for every thread count,
+// including a serial run on a pool of size 1.
+//
+// With Summation::NEUMAIER every block and every tree node also carries the
+// rounding error of its additions (Neumaier's variant of Kahan summation),
+// which makes the result accurate to about one rounding of the exact sum.
+
+enum class Summation
+{
+    PLAIN,
+    NEUMAIER
+};
+
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double x)
+    {
+        double t = sum + x;
+
+        if (std::abs(sum) >= std::abs(x))
+            compensation += (sum - t) + x;
+        else
+            compensation += (x - t) + sum;
+
+        sum = t;
+    }
+
+    void add(const CompensatedSum &other)
+    {
+        add(other.sum);
+        compensation += other.compensation;
+    }
+
+    double value() const
+    {
+        return sum + compensation;
+    }
+};
+
+// Pairwise tree over the partial sums in place, partial[0] holds the result
+template < typename T, typename Combine > T pairwiseCombine(std::vector< T > &partial, Combine combine)
+{
+    if (partial.empty())
+        return T{};
+
+    for (std::size_t width = 1; width < partial.size(); width *= 2)
+        for (std::size_t i = 0; i + width < partial.size(); i += 2 * width)
+            partial[i] = combine(partial[i], partial[i + width]);
+
+    return partial[0];
+}
+
+// Reduces [0, size) in blocks of blockSize. blockFn(begin, end, sum) must add
+// the terms of the block to sum (a CompensatedSum) in index order. For
+// PLAIN only sum.sum is used and the compensation is ignored.
+template < typename BlockFn >
+double reproducibleReduce(ThreadPool &pool, std::size_t size, BlockFn &&blockFn, Summation mode = Summation::NEUMAIER,
+                          std::size_t blockSize = 4096)
+{
+    std::size_t blocks = (size + blockSize - 1) / blockSize;
+
+    std::vector< CompensatedSum > partial(blocks);
+
+    pool.parallelFor(0, blocks, 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t b = first; b < last; ++b)
+        {
+            CompensatedSum sum;
+            blockFn(b * blockSize, std::min(size, (b + 1) * blockSize), sum);
+
+            if (mode == Summation::PLAIN)
+                sum.compensation = 0.0;
+
+            partial[b] = sum;
+        }
+    });
+
+    if (mode == Summation::PLAIN)
+        return pairwiseCombine(partial, [](CompensatedSum a, const CompensatedSum &b) {
+                   a.sum += b.sum;
+                   return a;
+               }).sum;
+
+    return pairwiseCombine(partial, [](CompensatedSum a, const CompensatedSum &b) {
+               a.add(b);
+               return a;
+           }).value();
+}
+
+// Sum of x[0 .. size)
+inline double reproducibleSum(ThreadPool &pool, const double *x, std::size_t size,
+                              Summation mode = Summation::NEUMAIER, std::size_t blockSize = 4096)
+{
+    if (mode == Summation::PLAIN)
+        return reproducibleReduce(
+            pool, size,
+            [x](std::size_t begin, std::size_t end, CompensatedSum &sum) {
+                double s = 0.0;
+                for (std::size_t i = begin; i < end; ++i)
+                    s += x[i];
+                sum.sum = s;
+            },
+            mode, blockSize);
+
+    return reproducibleReduce(
+        pool, size,
+        [x](std::size_t begin, std::size_t end, CompensatedSum &sum) {
+            for (std::size_t i = begin; i < end; ++i)
+                sum.add(x[i]);
+        },
+        mode, blockSize);
+}
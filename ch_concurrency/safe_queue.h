@@ -1,9 +1,25 @@
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <span>
+#include <thread>
 
-template < typename T > class SafeQueue {
+// Selects the SafeQueue implementation at compile time. MPMC is the general
+// mutex/condition variable queue, SPSC a ring buffer for pipelines with
+// exactly one producer thread and one consumer thread.
+enum class QueueMode
+{
+    MPMC,
+    SPSC
+};
+
+template < typename T, QueueMode Mode = QueueMode::MPMC > class SafeQueue {
 private:
     std::queue< T > m_queue;
     mutable std::mutex m_mutex;
@@ -31,6 +47,28 @@ public:
         }
     }
 
+    // Producer: Move all items into the queue (blocks while full). Each lock
+    // acquisition transfers as many items as there is space for.
+    void push_bulk(std::span< T > items)
+    {
+        size_t next = 0;
+
+        while (next < items.size())
+        {
+            std::unique_lock< std::mutex > lock(m_mutex);
+
+            m_cond.wait(lock, [this]() { return m_queue.size() < m_maxSize || m_finished; });
+
+            if (m_finished)
+                return;
+
+            while ((next < items.size()) && (m_queue.size() < m_maxSize))
+                m_queue.push(std::move(items[next++]));
+
+            m_cond.notify_all(); // Several consumers may be able to continue
+        }
+    }
+
     // Consumer: Remove item from queue (blocks if empty)
     std::optional< T > pop()
     {
@@ -48,8 +86,30 @@ public:
         return item;
     }
 
+    // Consumer: Remove up to items.size() items under a single lock (blocks
+    // if empty). Returns the number of items removed, 0 means no more data.
+    size_t pop_bulk(std::span< T > items)
+    {
+        std::unique_lock< std::mutex > lock(m_mutex);
+
+        m_cond.wait(lock, [this]() { return !m_queue.empty() || m_finished; });
+
+        size_t count = 0;
+
+        while ((count < items.size()) && !m_queue.empty())
+        {
+            items[count++] = std::move(m_queue.front());
+            m_queue.pop();
+        }
+
+        if (count > 0)
+            m_cond.notify_all(); // Several producers may be able to continue
+
+        return count;
+    }
+
     // Signal that no more items will be produced
-    void finish() 
+    void finish()
     {
         std::unique_lock< std::mutex > lock(m_mutex);
         m_finished = true;
@@ -62,3 +122,243 @@ public:
         return m_queue.size();
     }
 };
+
+// Single-producer/single-consumer specialization. Only the producer writes
+// the tail index and only the consumer writes the head index, so tryPush and
+// tryPop are wait-free: a load of the other side's index, a copy and a
+// release store. Each side keeps a cached copy of the other index and only
+// reloads it when the ring looks full or empty.
+//
+// Blocking push and pop spin and yield before parking on an atomic counter
+// with C++20 atomic wait/notify, like LockFreeQueue. Using it from more
+// than one producer or consumer thread is undefined.
+template < typename T > class SafeQueue< T, QueueMode::SPSC > {
+private:
+    static constexpr std::size_t cacheLine = 64;
+    static constexpr int spinCount = 64;
+    static constexpr int yieldCount = 64;
+
+    std::unique_ptr< T[] > m_items;
+    std::size_t m_mask;
+
+    // Consumer side
+    alignas(cacheLine) std::atomic< std::size_t > m_head{0};
+    std::size_t m_cachedTail = 0;
+    std::atomic< bool > m_consumerWaiting{false};
+
+    // Producer side
+    alignas(cacheLine) std::atomic< std::size_t > m_tail{0};
+    std::size_t m_cachedHead = 0;
+    std::atomic< bool > m_producerWaiting{false};
+
+    // Parking: the consumer waits on m_pushCount, the producer on m_popCount
+    alignas(cacheLine) std::atomic< std::uint32_t > m_pushCount{0};
+    std::atomic< std::uint32_t > m_popCount{0};
+
+    alignas(cacheLine) std::atomic< bool > m_finished{false};
+
+    static std::size_t roundUpPow2(std::size_t n)
+    {
+        std::size_t capacity = 2;
+        while (capacity < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    std::size_t freeSlots()
+    {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_cachedHead > m_mask)
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+
+        return m_mask + 1 - (tail - m_cachedHead);
+    }
+
+    std::size_t usedSlots()
+    {
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (m_cachedTail == head)
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+        return m_cachedTail - head;
+    }
+
+    // See LockFreeQueue::wakeConsumer for why the fence is needed
+    void wakeConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed))
+        {
+            m_pushCount.fetch_add(1);
+            m_pushCount.notify_one();
+        }
+    }
+
+    void wakeProducer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_producerWaiting.load(std::memory_order_relaxed))
+        {
+            m_popCount.fetch_add(1);
+            m_popCount.notify_one();
+        }
+    }
+
+    // Waits for free slots (producer) or items (consumer). Returns false once
+    // finish() has been called. The acquire load pairs with the store in
+    // finish(), so the producer's last m_tail stores are visible afterwards.
+    template < typename Ready > bool waitFor(Ready ready, std::atomic< std::uint32_t > &count,
+                                              std::atomic< bool > &waiting)
+    {
+        for (int spin = 0; !m_finished.load(std::memory_order_acquire); ++spin)
+        {
+            if (ready())
+                return true;
+
+            if (spin < spinCount)
+                continue;
+
+            if (spin < spinCount + yieldCount)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            waiting.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::uint32_t value = count.load();
+
+            if (!ready() && !m_finished.load())
+                count.wait(value);
+
+            waiting.store(false);
+        }
+
+        return false;
+    }
+
+public:
+    // Capacity is rounded up to the next power of two
+    SafeQueue(size_t maxSize = 10) : m_mask(roundUpPow2(maxSize) - 1)
+    {
+        m_items = std::make_unique< T[] >(m_mask + 1);
+    }
+
+    // Non-blocking push, returns false if the queue is full
+    bool tryPush(T &item)
+    {
+        if (freeSlots() == 0)
+            return false;
+
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        m_items[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Non-blocking pop, returns std::nullopt if the queue is empty
+    std::optional< T > tryPop()
+    {
+        if (usedSlots() == 0)
+            return std::nullopt;
+
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        T item = std::move(m_items[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return item;
+    }
+
+    // Producer: Add item to queue (blocks if full)
+    void push(T item)
+    {
+        if (waitFor([this]() { return freeSlots() > 0; }, m_popCount, m_producerWaiting))
+        {
+            tryPush(item);
+            wakeConsumer();
+        }
+    }
+
+    // Producer: Move all items into the queue (blocks while full), publishing
+    // as many items as there is space for with a single store
+    void push_bulk(std::span< T > items)
+    {
+        size_t next = 0;
+
+        while (next < items.size())
+        {
+            if (!waitFor([this]() { return freeSlots() > 0; }, m_popCount, m_producerWaiting))
+                return;
+
+            std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            std::size_t count = std::min(freeSlots(), items.size() - next);
+
+            for (std::size_t i = 0; i < count; ++i)
+                m_items[(tail + i) & m_mask] = std::move(items[next++]);
+
+            m_tail.store(tail + count, std::memory_order_release);
+            wakeConsumer();
+        }
+    }
+
+    // Consumer: Remove item from queue (blocks if empty)
+    std::optional< T > pop()
+    {
+        if (!waitFor([this]() { return usedSlots() > 0; }, m_pushCount, m_consumerWaiting))
+        {
+            // Items pushed before finish() are still delivered
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            return tryPop();
+        }
+
+        auto item = tryPop();
+        wakeProducer();
+        return item;
+    }
+
+    // Consumer: Remove up to items.size() items with a single store (blocks
+    // if empty). Returns the number of items removed, 0 means no more data.
+    size_t pop_bulk(std::span< T > items)
+    {
+        // After finish() the remaining items are still delivered
+        if (!waitFor([this]() { return usedSlots() > 0; }, m_pushCount, m_consumerWaiting))
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        std::size_t count = std::min(usedSlots(), items.size());
+
+        for (std::size_t i = 0; i < count; ++i)
+            items[i] = std::move(m_items[(head + i) & m_mask]);
+
+        if (count > 0)
+        {
+            m_head.store(head + count, std::memory_order_release);
+            wakeProducer();
+        }
+
+        return count;
+    }
+
+    // Signal that no more items will be produced
+    void finish()
+    {
+        m_finished.store(true);
+        m_pushCount.fetch_add(1);
+        m_popCount.fetch_add(1);
+        m_pushCount.notify_all(); // Wake all waiting threads
+        m_popCount.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::size_t head = m_head.load();
+        std::size_t tail = m_tail.load();
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// Double precision sine and cosine on Eigen packets, so one call computes
+// 2 (SSE2), 4 (AVX) or 8 (AVX-512) values. Eigen 3.4 only provides psin and
+// pcos for float packets, so these follow the Cephes sin/cos algorithm with
+// Eigen's packet primitives: reduction by pi/4 in three parts (Cody-Waite)
+// and degree 13/14 polynomials on [-pi/4, pi/4], both evaluated and
+// selected per lane. The error is at most 2 ulp for |x| < 1e6 and grows
+// slowly up to maxArgument = 2^30, where the reduction stops being exact (the
+// same limit as Cephes). Larger arguments, infinities and NaN give NaN.
+//
+// The square root is Eigen's psqrt, which is exact except for AVX-512 where
+// it is a Newton iteration with an error of up to 3 ulp.
+//
+// Without AVX the polynomials cost more than the scalar libm calls. Configure
+// with -DBUILD_NATIVE_SIMD=ON to compile the examples using this header for
+// the host CPU (-march=native), they print the SIMD width they were built for.
+
+namespace simd
+{
+
+using Packet = Eigen::internal::packet_traits< double >::type;
+
+constexpr int packetSize = Eigen::internal::packet_traits< double >::size;
+
+constexpr double maxArgument = 1073741824.0;
+
+namespace detail
+{
+
+// Octant j in {0, 2, 4, 6} and the reduced argument z of |x|
+EIGEN_STRONG_INLINE void reduce(const Packet &x, Packet &j, Packet &z)
+{
+    using namespace Eigen::internal;
+
+    const Packet fourOverPi = pset1< Packet >(1.27323954473516268615);
+    const Packet dp1 = pset1< Packet >(7.85398125648498535156E-1);
+    const Packet dp2 = pset1< Packet >(3.77489470793079817668E-8);
+    const Packet dp3 = pset1< Packet >(2.69515142907905952645E-15);
+    const Packet half = pset1< Packet >(0.5);
+    const Packet two = pset1< Packet >(2.0);
+    const Packet eighth = pset1< Packet >(0.125);
+    const Packet eight = pset1< Packet >(8.0);
+
+    Packet ax = pabs(x);
+    Packet y = pfloor(pmul(ax, fourOverPi));
+
+    // Round odd octants up, y = (y + 1) & ~1
+    y = padd(y, psub(y, pmul(two, pfloor(pmul(y, half)))));
+
+    z = psub(psub(psub(ax, pmul(y, dp1)), pmul(y, dp2)), pmul(y, dp3));
+    j = psub(y, pmul(eight, pfloor(pmul(y, eighth))));
+}
+
+EIGEN_STRONG_INLINE Packet sinPoly(const Packet &z, const Packet &zz)
+{
+    using namespace Eigen::internal;
+
+    Packet p = pset1< Packet >(1.58962301576546568060E-10);
+    p = pmadd(p, zz, pset1< Packet >(-2.50507477628578072866E-8));
+    p = pmadd(p, zz, pset1< Packet >(2.75573136213857245213E-6));
+    p = pmadd(p, zz, pset1< Packet >(-1.98412698295895385996E-4));
+    p = pmadd(p, zz, pset1< Packet >(8.33333333332211858878E-3));
+    p = pmadd(p, zz, pset1< Packet >(-1.66666666666666307295E-1));
+
+    return pmadd(pmul(z, zz), p, z);
+}
+
+// NaN in the lanes where |x| > maxArgument or x is NaN
+EIGEN_STRONG_INLINE Packet checkRange(const Packet &x, const Packet &y)
+{
+    using namespace Eigen::internal;
+
+    const Packet nan = pset1< Packet >(std::numeric_limits< double >::quiet_NaN());
+
+    return pselect(pcmp_le(pabs(x), pset1< Packet >(maxArgument)), y, nan);
+}
+
+EIGEN_STRONG_INLINE Packet cosPoly(const Packet &zz)
+{
+    using namespace Eigen::internal;
+
+    Packet p = pset1< Packet >(-1.13585365213876817300E-11);
+    p = pmadd(p, zz, pset1< Packet >(2.08757008419747316778E-9));
+    p = pmadd(p, zz, pset1< Packet >(-2.75573141792967388112E-7));
+    p = pmadd(p, zz, pset1< Packet >(2.48015872888517045348E-5));
+    p = pmadd(p, zz, pset1< Packet >(-1.38888888888730564116E-3));
+    p = pmadd(p, zz, pset1< Packet >(4.16666666666665929218E-2));
+
+    return padd(psub(pset1< Packet >(1.0), pmul(pset1< Packet >(0.5), zz)), pmul(pmul(zz, zz), p));
+}
+
+} // namespace detail
+
+EIGEN_STRONG_INLINE Packet psin(const Packet &x)
+{
+    using namespace Eigen::internal;
+
+    Packet j, z;
+    detail::reduce(x, j, z);
+
+    Packet zz = pmul(z, z);
+
+    // Octants 2 and 6 use the cosine polynomial, 4 and 6 are negative. The
+    // sign of x is applied last, so sin(-0) is -0.
+
+    Packet useCos = por(pcmp_eq(j, pset1< Packet >(2.0)), pcmp_eq(j, pset1< Packet >(6.0)));
+    Packet y = pselect(useCos, detail::cosPoly(zz), detail::sinPoly(z, zz));
+
+    y = pselect(pcmp_le(pset1< Packet >(4.0), j), pnegate(y), y);
+
+    return detail::checkRange(x, pxor(y, pand(x, pset1< Packet >(-0.0))));
+}
+
+EIGEN_STRONG_INLINE Packet pcos(const Packet &x)
+{
+    using namespace Eigen::internal;
+
+    Packet j, z;
+    detail::reduce(x, j, z);
+
+    Packet zz = pmul(z, z);
+
+    // Octants 2 and 6 use the sine polynomial, 2 and 4 are negative
+
+    Packet two = pset1< Packet >(2.0);
+    Packet useSin = por(pcmp_eq(j, two), pcmp_eq(j, pset1< Packet >(6.0)));
+    Packet y = pselect(useSin, detail::sinPoly(z, zz), detail::cosPoly(zz));
+
+    Packet negative = por(pcmp_eq(j, two), pcmp_eq(j, pset1< Packet >(4.0)));
+
+    return detail::checkRange(x, pselect(negative, pnegate(y), y));
+}
+
+// Distance in units in the last place between two doubles
+inline std::uint64_t ulpDistance(double a, double b)
+{
+    if (a == b)
+        return 0;
+
+    if (std::isnan(a) || std::isnan(b))
+        return UINT64_MAX;
+
+    auto ordered = [](double v) {
+        std::int64_t bits = std::bit_cast< std::int64_t >(v);
+        return bits < 0 ? INT64_MIN - bits : bits;
+    };
+
+    std::int64_t ia = ordered(a);
+    std::int64_t ib = ordered(b);
+
+    return ia > ib ? std::uint64_t(ia) - std::uint64_t(ib) : std::uint64_t(ib) - std::uint64_t(ia);
+}
+
+// Largest distance in ulp between packetFn and scalarFn on n evenly spaced
+// points in [xMin, xMax]
+template < typename PacketFn, typename ScalarFn >
+std::uint64_t maxUlpError(PacketFn packetFn, ScalarFn scalarFn, double xMin, double xMax, std::size_t n)
+{
+    std::uint64_t maxError = 0;
+
+    alignas(64) double x[packetSize];
+    alignas(64) double y[packetSize];
+
+    for (std::size_t i = 0; i < n; i += packetSize)
+    {
+        for (int k = 0; k < packetSize; ++k)
+            x[k] = xMin + (xMax - xMin) * double(std::min(i + k, n - 1)) / double(n > 1 ? n - 1 : 1);
+
+        Eigen::internal::pstoreu(y, packetFn(Eigen::internal::ploadu< Packet >(x)));
+
+        for (int k = 0; k < packetSize; ++k)
+            maxError = std::max(maxError, ulpDistance(y[k], scalarFn(x[k])));
+    }
+
+    return maxError;
+}
+
+// The heavyComputation kernel of the threads and async examples:
+//
+//   arr[i] = sin(arr[i]) * cos(arr[i]) * sqrt(|arr[i]|)
+//   arr[i] = sin(arr[i]), iterations times
+//
+// for packetSize elements at a time. The last partial packet is padded, so
+// every element goes through the same code. Returns the sum of the new
+// values.
+inline double heavyComputation(double *arr, std::size_t start, std::size_t end, int iterations)
+{
+    using namespace Eigen::internal;
+
+    auto kernel = [iterations](Packet x) {
+        x = pmul(pmul(psin(x), pcos(x)), psqrt(pabs(x)));
+
+        for (int j = 0; j < iterations; ++j)
+            x = psin(x);
+
+        return x;
+    };
+
+    Packet sum = pzero(Packet{});
+    std::size_t i = start;
+
+    for (; i + packetSize <= end; i += packetSize)
+    {
+        Packet x = kernel(ploadu< Packet >(arr + i));
+        pstoreu(arr + i, x);
+        sum = padd(sum, x);
+    }
+
+    double result = predux(sum);
+
+    if (i < end)
+    {
+        alignas(64) double tail[packetSize] = {};
+        std::copy(arr + i, arr + end, tail);
+
+        pstoreu(tail, kernel(ploadu< Packet >(tail)));
+
+        std::copy(tail, tail + (end - i), arr + i);
+
+        for (; i < end; ++i)
+            result += arr[i];
+    }
+
+    return result;
+}
+
+} // namespace simd
@@ -0,0 +1,640 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <omp.h>
+#include <vector>
+
+class StencilComputation {
+private:
+    Eigen::MatrixXd current_grid;
+    Eigen::MatrixXd next_grid;
+    int size;
+
+    // Tile size used by step_blocked() and step_temporal(). Eigen matrices
+    // are column-major, so a tile is block_rows contiguous values from each
+    // of block_cols columns.
+    int block_rows = 1024;
+    int block_cols = 64;
+
+    // Grid hierarchy for the multigrid V-cycle. Level l has n interior
+    // points in each direction at coordinates x (in fine grid spacings,
+    // x[0] and x[n + 1] are the boundary), the error u is zero on the
+    // boundary. Coarse point I lies on fine point 2I and the coarse boundary
+    // on the fine boundary, so for an even number of fine points the last
+    // coarse cell is half as wide as the others. The coarse operators and
+    // transfers use the coordinates, and all N converge alike. Level 0 is
+    // current_grid itself with unit spacing, only its residual is stored.
+    struct Level {
+        int n;
+        std::vector<double> x;
+        std::vector<double> west; // 1D second difference coefficients
+        std::vector<double> east;
+        Eigen::MatrixXd u;
+        Eigen::MatrixXd f;
+        Eigen::MatrixXd r;
+    };
+
+    // Interpolation of fine point i from coarse points I0 and I1
+    struct Transfer {
+        int I0;
+        int I1;
+        double w0;
+        double w1;
+    };
+
+    // Between levels l - 1 and l: prolong[i] for the fine points i, and
+    // restrict_weights[I] for fine points 2I - 1, 2I and 2I + 1 of coarse I
+    struct Transfers {
+        std::vector<Transfer> prolong;
+        std::vector<std::array<double, 3>> restrict_weights;
+    };
+
+    std::vector<Level> levels;
+    std::vector<Transfers> transfers; // transfers[l] between levels l - 1 and l
+
+    // In-place red-black Gauss-Seidel/SOR sweep of u for (4u - sum)/h2 = f.
+    // Returns the largest change of a single value during the sweep.
+    static double sweep_red_black(Eigen::MatrixXd &u, const Eigen::MatrixXd *f, double h2, double omega)
+    {
+        const int n = int(u.rows());
+        double change = 0.0;
+
+        for (int colour = 0; colour < 2; colour++)
+        {
+#pragma omp parallel for schedule(static) reduction(max : change)
+            for (int j = 1; j < n - 1; j++)
+            {
+                double *w = u.data() + (j - 1) * n;
+                double *c = u.data() + j * n;
+                double *e = u.data() + (j + 1) * n;
+                const double *rhs = f != nullptr ? f->data() + j * n : nullptr;
+
+                for (int i = 1 + (j + 1 + colour) % 2; i < n - 1; i += 2)
+                {
+                    double gs = 0.25 * (c[i - 1] + c[i + 1] + w[i] + e[i]);
+
+                    if (rhs != nullptr)
+                        gs += 0.25 * h2 * rhs[i];
+
+                    double delta = omega * (gs - c[i]);
+                    c[i] += delta;
+                    change = std::max(change, std::abs(delta));
+                }
+            }
+        }
+
+        return change;
+    }
+
+    // r = f - (4u - sum)/h2 in the interior, zero on the boundary. Returns
+    // max |r| * h2 / 4, which on the finest level is the same measure as the
+    // residual returned by step_jacobi().
+    static double residual(const Eigen::MatrixXd &u, const Eigen::MatrixXd *f, double h2, Eigen::MatrixXd &r)
+    {
+        const int n = int(u.rows());
+        double norm = 0.0;
+
+        r.setZero(n, n);
+
+#pragma omp parallel for schedule(static) reduction(max : norm)
+        for (int j = 1; j < n - 1; j++)
+        {
+            const double *w = u.data() + (j - 1) * n;
+            const double *c = u.data() + j * n;
+            const double *e = u.data() + (j + 1) * n;
+            const double *rhs = f != nullptr ? f->data() + j * n : nullptr;
+            double *out = r.data() + j * n;
+
+            for (int i = 1; i < n - 1; i++)
+            {
+                double value = (c[i - 1] + c[i + 1] + w[i] + e[i] - 4.0 * c[i]) / h2;
+
+                if (rhs != nullptr)
+                    value += rhs[i];
+
+                out[i] = value;
+                norm = std::max(norm, std::abs(value));
+            }
+        }
+
+        return norm * h2 / 4.0;
+    }
+
+    static Level make_level(std::vector<double> x)
+    {
+        const int n = int(x.size()) - 2;
+
+        Level level{n, std::move(x), std::vector<double>(n + 2, 0.0), std::vector<double>(n + 2, 0.0),
+                    Eigen::MatrixXd::Zero(n + 2, n + 2), Eigen::MatrixXd::Zero(n + 2, n + 2), Eigen::MatrixXd()};
+
+        for (int i = 1; i <= n; i++)
+        {
+            double hl = level.x[i] - level.x[i - 1];
+            double hr = level.x[i + 1] - level.x[i];
+
+            level.west[i] = 2.0 / (hl * (hl + hr));
+            level.east[i] = 2.0 / (hr * (hl + hr));
+        }
+
+        return level;
+    }
+
+    // Linear interpolation in x (prolongation) and its transpose weighted by
+    // the cell sizes (restriction). With uniform spacing these are bilinear
+    // interpolation and full weighting.
+    static Transfers make_transfers(const std::vector<double> &x, const std::vector<double> &X)
+    {
+        const int n = int(x.size()) - 2;
+        const int nc = int(X.size()) - 2;
+
+        Transfers t;
+        t.prolong.resize(n + 2);
+
+        for (int i = 0; i <= n + 1; i++)
+        {
+            if (i % 2 == 0)
+                t.prolong[i] = {i / 2, i / 2, 1.0, 0.0};
+            else
+            {
+                double w0 = (x[i + 1] - x[i]) / (x[i + 1] - x[i - 1]);
+                t.prolong[i] = {(i - 1) / 2, (i + 1) / 2, w0, 1.0 - w0};
+            }
+        }
+
+        t.restrict_weights.resize(nc + 2);
+
+        for (int I = 1; I <= nc; I++)
+        {
+            int k = 2 * I;
+            double coarse_cell = X[I + 1] - X[I - 1];
+            auto cell = [&x](int i) { return x[i + 1] - x[i - 1]; };
+
+            t.restrict_weights[I] = {t.prolong[k - 1].w1 * cell(k - 1) / coarse_cell, cell(k) / coarse_cell,
+                                     k + 1 <= n ? t.prolong[k + 1].w0 * cell(k + 1) / coarse_cell : 0.0};
+        }
+
+        return t;
+    }
+
+    // Red-black Gauss-Seidel sweep of a coarse level, (A u)_ij = f_ij with the
+    // variable coefficient five point operator of the level
+    static void sweep_level(Level &level)
+    {
+        const int n = level.n + 2;
+        const double *west = level.west.data();
+        const double *east = level.east.data();
+
+        for (int colour = 0; colour < 2; colour++)
+        {
+#pragma omp parallel for schedule(static)
+            for (int j = 1; j < n - 1; j++)
+            {
+                double *w = level.u.data() + (j - 1) * n;
+                double *c = level.u.data() + j * n;
+                double *e = level.u.data() + (j + 1) * n;
+                const double *rhs = level.f.data() + j * n;
+
+                for (int i = 1 + (j + 1 + colour) % 2; i < n - 1; i += 2)
+                {
+                    double diagonal = west[i] + east[i] + west[j] + east[j];
+                    c[i] = (rhs[i] + west[i] * c[i - 1] + east[i] * c[i + 1] + west[j] * w[i] + east[j] * e[i]) /
+                           diagonal;
+                }
+            }
+        }
+    }
+
+    // r = f - A u of a coarse level in the interior, zero on the boundary
+    static void residual_level(Level &level)
+    {
+        const int n = level.n + 2;
+        const double *west = level.west.data();
+        const double *east = level.east.data();
+
+        level.r.setZero(n, n);
+
+#pragma omp parallel for schedule(static)
+        for (int j = 1; j < n - 1; j++)
+        {
+            const double *w = level.u.data() + (j - 1) * n;
+            const double *c = level.u.data() + j * n;
+            const double *e = level.u.data() + (j + 1) * n;
+            const double *rhs = level.f.data() + j * n;
+            double *out = level.r.data() + j * n;
+
+            for (int i = 1; i < n - 1; i++)
+            {
+                double diagonal = west[i] + east[i] + west[j] + east[j];
+                out[i] = rhs[i] - (diagonal * c[i] - west[i] * c[i - 1] - east[i] * c[i + 1] - west[j] * w[i] -
+                                   east[j] * e[i]);
+            }
+        }
+    }
+
+    // Weighted restriction of the fine residual r onto the coarse right hand
+    // side f
+    static void restrict_residual(const Eigen::MatrixXd &r, Eigen::MatrixXd &f, int nc, const Transfers &t)
+    {
+#pragma omp parallel for schedule(static)
+        for (int J = 1; J <= nc; J++)
+        {
+            const auto &wj = t.restrict_weights[J];
+
+            for (int I = 1; I <= nc; I++)
+            {
+                const auto &wi = t.restrict_weights[I];
+                double sum = 0.0;
+
+                for (int b = 0; b < 3; b++)
+                    for (int a = 0; a < 3; a++)
+                        sum += wi[a] * wj[b] * r(2 * I - 1 + a, 2 * J - 1 + b);
+
+                f(I, J) = sum;
+            }
+        }
+    }
+
+    // Interpolation of the coarse error e, added to the fine u
+    static void prolongate(const Eigen::MatrixXd &e, Eigen::MatrixXd &u, int n, const Transfers &t)
+    {
+#pragma omp parallel for schedule(static)
+        for (int j = 1; j <= n; j++)
+        {
+            const Transfer &pj = t.prolong[j];
+
+            for (int i = 1; i <= n; i++)
+            {
+                const Transfer &pi = t.prolong[i];
+
+                u(i, j) += pj.w0 * (pi.w0 * e(pi.I0, pj.I0) + pi.w1 * e(pi.I1, pj.I0)) +
+                           pj.w1 * (pi.w0 * e(pi.I0, pj.I1) + pi.w1 * e(pi.I1, pj.I1));
+            }
+        }
+    }
+
+    void vcycle_level(int l, int pre, int post)
+    {
+        Level &level = levels[l];
+
+        if ((l == int(levels.size()) - 1) || (level.n <= 3))
+        {
+            for (int k = 0; k < 50; k++)
+                sweep_level(level);
+            return;
+        }
+
+        for (int k = 0; k < pre; k++)
+            sweep_level(level);
+
+        residual_level(level);
+
+        Level &coarse = levels[l + 1];
+        coarse.u.setZero();
+        restrict_residual(level.r, coarse.f, coarse.n, transfers[l + 1]);
+
+        vcycle_level(l + 1, pre, post);
+
+        prolongate(coarse.u, level.u, level.n, transfers[l + 1]);
+
+        for (int k = 0; k < post; k++)
+            sweep_level(level);
+    }
+
+public:
+    // One Jacobi update of rows [i0, i1) in a column. w, c and e point to the
+    // west, centre and east columns, out to the destination column.
+    static void update_column(const double *w, const double *c, const double *e, double *out, int i0, int i1)
+    {
+#pragma omp simd
+        for (int i = i0; i < i1; i++)
+            out[i] = 0.25 * (c[i - 1] + c[i + 1] + w[i] + e[i]);
+    }
+
+    // Jacobi update of rows [i0, i1) that also returns the largest change,
+    // i.e. the max-norm of the residual, without an extra pass over memory.
+    static double update_column_residual(const double *w, const double *c, const double *e, double *out, int i0,
+                                         int i1)
+    {
+        double res = 0.0;
+
+#pragma omp simd reduction(max : res)
+        for (int i = i0; i < i1; i++)
+        {
+            double value = 0.25 * (c[i - 1] + c[i + 1] + w[i] + e[i]);
+            res = std::max(res, std::abs(value - c[i]));
+            out[i] = value;
+        }
+
+        return res;
+    }
+
+    // With in_place set, no next_grid is allocated. Only the in-place
+    // solvers, step_sor() and vcycle(), can be used then.
+    StencilComputation(int n, bool in_place = false) : size(n)
+    {
+        current_grid = Eigen::MatrixXd::Zero(n, n);
+
+        if (!in_place)
+            next_grid = Eigen::MatrixXd::Zero(n, n);
+    }
+
+    void initialize()
+    {
+// Set initial conditions
+#pragma omp parallel for collapse(2)
+        for (int i = 1; i < size - 1; i++)
+        {
+            for (int j = 1; j < size - 1; j++)
+            {
+                current_grid(i, j) = 0.0;
+            }
+        }
+
+        const bool has_next = next_grid.size() > 0;
+
+// Set boundary conditions
+#pragma omp parallel sections
+        {
+#pragma omp section
+            {
+                // Top boundary
+                for (int j = 0; j < size; j++)
+                {
+                    current_grid(0, j) = 100.0;
+                    if (has_next)
+                        next_grid(0, j) = 100.0;
+                }
+            }
+#pragma omp section
+            {
+                // Bottom boundary
+                for (int j = 0; j < size; j++)
+                {
+                    current_grid(size - 1, j) = 0.0;
+                    if (has_next)
+                        next_grid(size - 1, j) = 0.0;
+                }
+            }
+#pragma omp section
+            {
+                // Left boundary
+                for (int i = 0; i < size; i++)
+                {
+                    current_grid(i, 0) = 50.0;
+                    if (has_next)
+                        next_grid(i, 0) = 50.0;
+                }
+            }
+#pragma omp section
+            {
+                // Right boundary
+                for (int i = 0; i < size; i++)
+                {
+                    current_grid(i, size - 1) = 50.0;
+                    if (has_next)
+                        next_grid(i, size - 1) = 50.0;
+                }
+            }
+        }
+    }
+
+    void set_block_size(int rows, int cols)
+    {
+        block_rows = rows;
+        block_cols = cols;
+    }
+
+    void step()
+    {
+// Compute next timestep
+#pragma omp parallel for collapse(2)
+        for (int i = 1; i < size - 1; i++)
+        {
+            for (int j = 1; j < size - 1; j++)
+            {
+                next_grid(i, j) = 0.25 * (current_grid(i - 1, j) + current_grid(i + 1, j) + current_grid(i, j - 1) +
+                                          current_grid(i, j + 1));
+            }
+        }
+
+        // Swap grids
+        std::swap(current_grid, next_grid);
+    }
+
+    // Same update as step(), but the inner loop runs down a column so that
+    // it is contiguous in Eigen's storage order and vectorizes. The grid is
+    // processed in tiles small enough for the three active column segments
+    // to stay in L1 cache.
+    void step_blocked()
+    {
+        const int n = size;
+        const double *cur = current_grid.data();
+        double *next = next_grid.data();
+
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int jb = 1; jb < n - 1; jb += block_cols)
+        {
+            for (int ib = 1; ib < n - 1; ib += block_rows)
+            {
+                int je = std::min(jb + block_cols, n - 1);
+                int ie = std::min(ib + block_rows, n - 1);
+
+                for (int j = jb; j < je; j++)
+                    update_column(cur + (j - 1) * n, cur + j * n, cur + (j + 1) * n, next + j * n, ib, ie);
+            }
+        }
+
+        std::swap(current_grid, next_grid);
+    }
+
+    // Advances the solution by steps time steps in a single pass over memory
+    // using overlapped temporal tiling. Each tile is copied together with a
+    // halo of width steps into a thread-local buffer, where all time steps are
+    // done while the valid region shrinks by one cell per step. Only the tile
+    // itself is written back, so the result is identical to calling step()
+    // steps times at the cost of some redundant work in the halos.
+    void step_temporal(int steps)
+    {
+        const int n = size;
+
+#pragma omp parallel
+        {
+            Eigen::MatrixXd a;
+            Eigen::MatrixXd b;
+
+#pragma omp for collapse(2) schedule(static)
+            for (int jb = 1; jb < n - 1; jb += block_cols)
+            {
+                for (int ib = 1; ib < n - 1; ib += block_rows)
+                {
+                    int je = std::min(jb + block_cols, n - 1);
+                    int ie = std::min(ib + block_rows, n - 1);
+
+                    int gi0 = std::max(0, ib - steps);
+                    int gi1 = std::min(n, ie + steps);
+                    int gj0 = std::max(0, jb - steps);
+                    int gj1 = std::min(n, je + steps);
+
+                    a = current_grid.block(gi0, gj0, gi1 - gi0, gj1 - gj0);
+                    b = a;
+
+                    const int ld = gi1 - gi0;
+
+                    for (int t = 0; t < steps; t++)
+                    {
+                        int r = steps - 1 - t;
+                        int i0 = std::max(1, ib - r) - gi0;
+                        int i1 = std::min(n - 1, ie + r) - gi0;
+                        int j0 = std::max(1, jb - r) - gj0;
+                        int j1 = std::min(n - 1, je + r) - gj0;
+
+                        const double *src = a.data();
+                        double *dst = b.data();
+
+                        for (int j = j0; j < j1; j++)
+                            update_column(src + (j - 1) * ld, src + j * ld, src + (j + 1) * ld, dst + j * ld, i0, i1);
+
+                        a.swap(b);
+                    }
+
+                    next_grid.block(ib, jb, ie - ib, je - jb) = a.block(ib - gi0, jb - gj0, ie - ib, je - jb);
+                }
+            }
+        }
+
+        std::swap(current_grid, next_grid);
+    }
+
+    // Jacobi sweep like step_blocked() with the residual max-norm reduced
+    // during the sweep. The returned residual belongs to the grid before the
+    // sweep.
+    double step_jacobi()
+    {
+        const int n = size;
+        const double *cur = current_grid.data();
+        double *next = next_grid.data();
+        double res = 0.0;
+
+#pragma omp parallel for collapse(2) schedule(static) reduction(max : res)
+        for (int jb = 1; jb < n - 1; jb += block_cols)
+        {
+            for (int ib = 1; ib < n - 1; ib += block_rows)
+            {
+                int je = std::min(jb + block_cols, n - 1);
+                int ie = std::min(ib + block_rows, n - 1);
+
+                for (int j = jb; j < je; j++)
+                    res = std::max(res, update_column_residual(cur + (j - 1) * n, cur + j * n, cur + (j + 1) * n,
+                                                               next + j * n, ib, ie));
+            }
+        }
+
+        std::swap(current_grid, next_grid);
+
+        return res;
+    }
+
+    // In-place red-black SOR sweep, omega = 1 gives Gauss-Seidel. Returns the
+    // largest Gauss-Seidel correction seen during the sweep.
+    double step_sor(double omega)
+    {
+        return sweep_red_black(current_grid, nullptr, 1.0, omega) / omega;
+    }
+
+    // Over-relaxation factor that is optimal for the Laplace equation on
+    // this grid.
+    double optimal_omega() const
+    {
+        return 2.0 / (1.0 + std::sin(std::numbers::pi / (size - 1)));
+    }
+
+    // One geometric multigrid V(pre, post) cycle with red-black Gauss-Seidel
+    // smoothing. Returns the residual max-norm after pre-smoothing on the
+    // finest level, scaled like the residual of step_jacobi().
+    double vcycle(int pre = 2, int post = 2)
+    {
+        if (levels.empty())
+        {
+            std::vector<double> x(size);
+
+            for (int i = 0; i < size; i++)
+                x[i] = i;
+
+            levels.push_back(make_level(x));
+            transfers.emplace_back();
+
+            while (levels.back().n > 1)
+            {
+                const std::vector<double> &fine = levels.back().x;
+                const int n = int(fine.size()) - 2;
+
+                std::vector<double> coarse(n / 2 + 2);
+
+                for (int I = 0; I <= n / 2; I++)
+                    coarse[I] = fine[2 * I];
+                coarse.back() = fine.back();
+
+                transfers.push_back(make_transfers(fine, coarse));
+                levels.push_back(make_level(std::move(coarse)));
+            }
+
+            // Level 0 works directly on current_grid with a zero right hand side
+            levels[0].u.resize(0, 0);
+            levels[0].f.resize(0, 0);
+        }
+
+        for (int k = 0; k < pre; k++)
+            sweep_red_black(current_grid, nullptr, 1.0, 1.0);
+
+        double res = residual(current_grid, nullptr, 1.0, levels[0].r);
+
+        if (levels.size() > 1)
+        {
+            Level &coarse = levels[1];
+            coarse.u.setZero();
+            restrict_residual(levels[0].r, coarse.f, coarse.n, transfers[1]);
+
+            vcycle_level(1, pre, post);
+
+            prolongate(coarse.u, current_grid, size - 2, transfers[1]);
+        }
+
+        for (int k = 0; k < post; k++)
+            sweep_red_black(current_grid, nullptr, 1.0, 1.0);
+
+        return res;
+    }
+
+    void print_grid() const
+    {
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = 0; j < size; j++)
+            {
+                std::cout << std::fixed << std::setprecision(1) << current_grid(i, j) << " ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    double get_value(int i, int j) const
+    {
+        return current_grid(i, j);
+    }
+
+    const Eigen::MatrixXd &grid() const
+    {
+        return current_grid;
+    }
+
+    int n() const
+    {
+        return size;
+    }
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent work-stealing thread pool. The worker threads are created once
+// and sleep (C++20 atomic wait) while there is no work, so a parallel loop
+// costs a few queue operations instead of creating and joining threads.
+//
+// Every worker has its own deque of tasks. parallelFor() pushes the whole
+// range as one task. A thread that runs a task keeps splitting it in halves,
+// pushes the right halves on its own deque and processes the left-most piece
+// of at most grain elements. Owners pop from the back (the most recent and
+// smallest pieces, still in cache) and idle threads steal from the front of
+// other deques (the oldest and largest pieces), so the work is balanced
+// dynamically instead of in equal static chunks. The calling thread takes
+// part in the work while it waits.
+//
+// The deques are guarded by one mutex each, which is only contended when a
+// thief and the owner meet on the same deque.
+
+class ThreadPool {
+private:
+    static constexpr std::size_t cacheLine = 64;
+    static constexpr int spinCount = 64;
+
+    struct Task {
+        void (*run)(ThreadPool &pool, const Task &task) = nullptr;
+        void *state = nullptr;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    struct alignas(cacheLine) WorkQueue {
+        std::mutex mutex;
+        std::deque< Task > tasks;
+    };
+
+    template < typename Fn > struct ForState {
+        Fn *fn;
+        std::size_t grain;
+        std::atomic< std::size_t > remaining;
+    };
+
+    // Deques 0 .. n - 2 belong to the workers, the last one is shared by
+    // threads outside the pool
+    std::unique_ptr< WorkQueue[] > m_queues;
+    int m_queueCount;
+    std::vector< std::jthread > m_workers;
+
+    alignas(cacheLine) std::atomic< std::int64_t > m_queued{0};
+    alignas(cacheLine) std::atomic< std::uint32_t > m_epoch{0};
+    std::atomic< int > m_sleeping{0};
+    std::atomic< bool > m_stop{false};
+
+    static inline thread_local ThreadPool *t_pool = nullptr;
+    static inline thread_local int t_index = 0;
+
+    int ownQueue() const
+    {
+        return t_pool == this ? t_index : m_queueCount - 1;
+    }
+
+    // Same pattern as LockFreeQueue: the fence orders the preceding change
+    // before the sleeper check, a thread that goes to sleep afterwards sees
+    // the change in its last check.
+    void wake(bool all)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (m_sleeping.load(std::memory_order_relaxed) > 0)
+        {
+            m_epoch.fetch_add(1);
+
+            if (all)
+                m_epoch.notify_all();
+            else
+                m_epoch.notify_one();
+        }
+    }
+
+    void push(const Task &task)
+    {
+        WorkQueue &queue = m_queues[ownQueue()];
+
+        {
+            std::lock_guard< std::mutex > lock(queue.mutex);
+            queue.tasks.push_back(task);
+        }
+
+        m_queued.fetch_add(1);
+        wake(false);
+    }
+
+    // Pops from the own deque, otherwise steals from the others
+    bool tryPop(Task &task)
+    {
+        if (m_queued.load(std::memory_order_relaxed) <= 0)
+            return false;
+
+        int own = ownQueue();
+
+        {
+            WorkQueue &queue = m_queues[own];
+            std::lock_guard< std::mutex > lock(queue.mutex);
+
+            if (!queue.tasks.empty())
+            {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        for (int i = 1; i < m_queueCount; ++i)
+        {
+            WorkQueue &queue = m_queues[(own + i) % m_queueCount];
+            std::unique_lock< std::mutex > lock(queue.mutex, std::try_to_lock);
+
+            if (lock.owns_lock() && !queue.tasks.empty())
+            {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                m_queued.fetch_sub(1);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Sleeps until new tasks are pushed or a loop completes, unless done()
+    // already holds or tasks are queued
+    template < typename Done > void sleep(Done &&done)
+    {
+        std::uint32_t epoch = m_epoch.load();
+
+        m_sleeping.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if ((m_queued.load() <= 0) && !done())
+            m_epoch.wait(epoch);
+
+        m_sleeping.fetch_sub(1);
+    }
+
+    void workerLoop(int index)
+    {
+        t_pool = this;
+        t_index = index;
+
+        while (!m_stop.load(std::memory_order_relaxed))
+        {
+            Task task;
+
+            bool found = false;
+
+            for (int spin = 0; spin < spinCount && !found; ++spin)
+            {
+                found = tryPop(task);
+
+                if (!found)
+                    std::this_thread::yield();
+            }
+
+            if (found)
+                task.run(*this, task);
+            else
+                sleep([this]() { return m_stop.load(); });
+        }
+    }
+
+    template < typename Fn > static void runFor(ThreadPool &pool, const Task &task)
+    {
+        auto *state = static_cast< ForState< Fn > * >(task.state);
+        std::size_t begin = task.begin;
+        std::size_t end = task.end;
+
+        while (end - begin > state->grain)
+        {
+            std::size_t mid = begin + (end - begin) / 2;
+            pool.push(Task{&runFor< Fn >, state, mid, end});
+            end = mid;
+        }
+
+        (*state->fn)(begin, end);
+
+        // The state lives on the stack of the waiting caller, it must not be
+        // touched after the last decrement
+
+        std::size_t count = end - begin;
+
+        if (state->remaining.fetch_sub(count) == count)
+            pool.wake(true);
+    }
+
+public:
+    // Creates threads - 1 workers, the thread calling parallelFor() is the
+    // last one. 0 uses all hardware threads.
+    explicit ThreadPool(int threads = 0)
+    {
+        if (threads <= 0)
+            threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+        m_queueCount = threads;
+        m_queues = std::make_unique< WorkQueue[] >(m_queueCount);
+
+        m_workers.reserve(threads - 1);
+
+        for (int i = 0; i < threads - 1; ++i)
+            m_workers.emplace_back([this, i]() { workerLoop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        m_stop.store(true);
+        m_epoch.fetch_add(1);
+        m_epoch.notify_all();
+        m_workers.clear(); // Joins
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads taking part in a loop, including the caller
+    int size() const
+    {
+        return m_queueCount;
+    }
+
+    // Pool shared by the whole program, created on first use
+    static ThreadPool &global()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // Calls fn(begin, end) on disjoint sub-ranges of [first, last) of at most
+    // grain elements, concurrently, and returns when all have finished.
+    // grain 0 picks about 8 pieces per thread. fn must not throw. Can be
+    // called from several threads and from inside fn.
+    template < typename Fn > void parallelFor(std::size_t first, std::size_t last, std::size_t grain, Fn &&fn)
+    {
+        if (first >= last)
+            return;
+
+        if (grain == 0)
+            grain = std::max< std::size_t >(1, (last - first) / (8 * std::size_t(size())));
+
+        using F = std::remove_reference_t< Fn >;
+
+        ForState< F > state{&fn, grain, {last - first}};
+
+        runFor< F >(*this, Task{&runFor< F >, &state, first, last});
+
+        // Help with the remaining pieces, of this or any other loop
+
+        while (state.remaining.load() != 0)
+        {
+            Task task;
+
+            if (tryPop(task))
+                task.run(*this, task);
+            else
+                sleep([&state]() { return state.remaining.load() == 0; });
+        }
+    }
+
+    // Combines map(begin, end) of all pieces with combine, starting from
+    // init. Pieces finish in any order, so combine must be associative and
+    // commutative.
+    template < typename T, typename Map, typename Combine >
+    T parallelReduce(std::size_t first, std::size_t last, std::size_t grain, T init, Map &&map, Combine &&combine)
+    {
+        std::mutex mutex;
+        T result = init;
+
+        parallelFor(first, last, grain, [&](std::size_t begin, std::size_t end) {
+            T value = map(begin, end);
+            std::lock_guard< std::mutex > lock(mutex);
+            result = combine(result, value);
+        });
+
+        return result;
+    }
+};
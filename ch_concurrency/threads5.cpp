@@ -7,6 +7,9 @@
 #include <thread>
 #include <vector>
 
+#include "simd_math.h"
+#include "thread_pool.h"
+
 // Function to perform a computationally intensive task
 void heavyComputation(double *arr, size_t start, size_t end)
 {
@@ -39,6 +42,29 @@ void processParallel(double *data, size_t size, int numThreads)
     }
 }
 
+// Vectorised variant, simd::packetSize elements at a time
+void heavyComputationSimd(double *arr, size_t start, size_t end)
+{
+    simd::heavyComputation(arr, start, end, 100);
+}
+
+void processSequentialSimd(double *data, size_t size)
+{
+    heavyComputationSimd(data, 0, size);
+}
+
+// Same work on the persistent pool, split dynamically into pieces of at
+// most grain elements
+void processPool(ThreadPool &pool, double *data, size_t size, size_t grain = 0)
+{
+    pool.parallelFor(0, size, grain, [data](size_t start, size_t end) { heavyComputation(data, start, end); });
+}
+
+void processPoolSimd(ThreadPool &pool, double *data, size_t size, size_t grain = 0)
+{
+    pool.parallelFor(0, size, grain, [data](size_t start, size_t end) { heavyComputationSimd(data, start, end); });
+}
+
 int main()
 {
     const size_t dataSize = 5000000;
@@ -51,10 +77,13 @@ int main()
 
     auto seqData = std::make_unique< double[] >(dataSize);
     auto parData = std::make_unique< double[] >(dataSize);
+    auto poolData = std::make_unique< double[] >(dataSize);
 
     std::print("Initialising arrays...\n");
 
     std::generate_n(seqData.get(), dataSize, []() { return 1.0; });
+    std::generate_n(parData.get(), dataSize, []() { return 1.0; });
+    std::generate_n(poolData.get(), dataSize, []() { return 1.0; });
 
     std::print("Running serially...\n");
 
@@ -76,5 +105,86 @@ int main()
     std::print("Time for parallel processing: {0} seconds\n", elapsedParallel.count());
     std::print("Speedup: {0}\n", elapsedSerially.count() / elapsedParallel.count());
 
+    // The pool threads are created once and reused by every call
+
+    ThreadPool pool(numThreads);
+
+    std::print("Running on thread pool...\n");
+
+    start = std::chrono::high_resolution_clock::now();
+    processPool(pool, poolData.get(), dataSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsedPool = end - start;
+
+    std::print("Time for thread pool processing: {0} seconds\n", elapsedPool.count());
+    std::print("Speedup: {0}\n", elapsedSerially.count() / elapsedPool.count());
+
+    // Vectorised kernel, checked against the scalar results
+
+    std::print("SIMD width: {0} doubles\n", simd::packetSize);
+    std::print("Max error on [-10, 10]: sin {0} ulp, cos {1} ulp, sqrt {2} ulp\n",
+               simd::maxUlpError(simd::psin, [](double x) { return std::sin(x); }, -10.0, 10.0, 1000000),
+               simd::maxUlpError(simd::pcos, [](double x) { return std::cos(x); }, -10.0, 10.0, 1000000),
+               simd::maxUlpError(Eigen::internal::psqrt< simd::Packet >, [](double x) { return std::sqrt(x); },
+                                 0.0, 10.0, 1000000));
+
+    auto simdData = std::make_unique< double[] >(dataSize);
+    std::generate_n(simdData.get(), dataSize, []() { return 1.0; });
+
+    std::print("Running SIMD serially...\n");
+
+    start = std::chrono::high_resolution_clock::now();
+    processSequentialSimd(simdData.get(), dataSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsedSimdSerially = end - start;
+
+    std::uint64_t maxUlp = 0;
+    for (size_t i = 0; i < dataSize; ++i)
+        maxUlp = std::max(maxUlp, simd::ulpDistance(simdData[i], seqData[i]));
+
+    std::print("Time for sequential SIMD processing: {0} seconds\n", elapsedSimdSerially.count());
+    std::print("Max difference to scalar results: {0} ulp\n", maxUlp);
+    std::print("Speedup per core: {0}\n", elapsedSerially.count() / elapsedSimdSerially.count());
+
+    std::generate_n(simdData.get(), dataSize, []() { return 1.0; });
+
+    std::print("Running SIMD on thread pool...\n");
+
+    start = std::chrono::high_resolution_clock::now();
+    processPoolSimd(pool, simdData.get(), dataSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsedSimdPool = end - start;
+
+    std::print("Time for SIMD thread pool processing: {0} seconds\n", elapsedSimdPool.count());
+    std::print("Speedup: {0} (threads {1} x SIMD {2})\n", elapsedSerially.count() / elapsedSimdPool.count(),
+               elapsedSerially.count() / elapsedPool.count(), elapsedPool.count() / elapsedSimdPool.count());
+
+    // Many small calls, where creating threads on every call dominates
+
+    const size_t callSize = 100;
+    const int calls = 2000;
+
+    std::print("Running {0} calls of {1} elements...\n", calls, callSize);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+        processParallel(parData.get() + i * callSize, callSize, numThreads);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsedSpawnCalls = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+        processPool(pool, poolData.get() + i * callSize, callSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration< double > elapsedPoolCalls = end - start;
+
+    std::print("Time per call, threads per call: {0} us\n", elapsedSpawnCalls.count() / calls * 1e6);
+    std::print("Time per call, thread pool: {0} us\n", elapsedPoolCalls.count() / calls * 1e6);
+
     return 0;
 }
@@ -7,6 +7,22 @@
 #include <vector>
 #include <print>
 
+#include "numa_array.h"
+#include "reproducible_sum.h"
+#include "simd_math.h"
+#include "thread_pool.h"
+
+// Computationally intensive task for a single element
+double heavyElement(double x)
+{
+    x = std::sin(x) * std::cos(x) * std::sqrt(std::abs(x));
+    for (int j = 0; j < 100; ++j)
+    {
+        x = std::sin(x);
+    }
+    return x;
+}
+
 // Function to perform a computationally intensive task
 void heavyComputation(double *arr, size_t start, size_t end, std::atomic<double> &sum)
 {
@@ -14,11 +30,7 @@ void heavyComputation(double *arr, size_t start, size_t end, std::atomic<double>
 
     for (size_t i = start; i < end; ++i)
     {
-        arr[i] = std::sin(arr[i]) * std::cos(arr[i]) * std::sqrt(std::abs(arr[i]));
-        for (int j = 0; j < 100; ++j)
-        {
-            arr[i] = std::sin(arr[i]);
-        }
+        arr[i] = heavyElement(arr[i]);
         localSum += arr[i];
     }
 
@@ -81,6 +93,53 @@ void processParallel(double *data, size_t size, int numThreads, std::atomic<doub
     // Manual join is not needed and would cause issues
 }
 
+// Pool versions. The pool splits the range dynamically and the partial sums
+// are combined by parallelReduce, so no atomic is needed.
+
+void initialisePool(ThreadPool &pool, double *data, size_t size, double value)
+{
+    pool.parallelFor(0, size, 0, [data, value](size_t start, size_t end) { initialiseArray(data, start, end, value); });
+}
+
+double processPool(ThreadPool &pool, double *data, size_t size)
+{
+    return pool.parallelReduce(
+        0, size, 0, 0.0,
+        [data](size_t start, size_t end) {
+            double localSum = 0.0;
+            for (size_t i = start; i < end; ++i)
+            {
+                data[i] = heavyElement(data[i]);
+                localSum += data[i];
+            }
+            return localSum;
+        },
+        [](double a, double b) { return a + b; });
+}
+
+// Vectorised kernel, simd::packetSize elements at a time
+double processPoolSimd(ThreadPool &pool, double *data, size_t size)
+{
+    return pool.parallelReduce(
+        0, size, 0, 0.0, [data](size_t start, size_t end) { return simd::heavyComputation(data, start, end, 100); },
+        [](double a, double b) { return a + b; });
+}
+
+// Reproducible version, the sum is the same for every thread count
+double processReproducible(ThreadPool &pool, double *data, size_t size, Summation mode)
+{
+    return reproducibleReduce(
+        pool, size,
+        [data](size_t start, size_t end, CompensatedSum &sum) {
+            for (size_t i = start; i < end; ++i)
+            {
+                data[i] = heavyElement(data[i]);
+                sum.add(data[i]);
+            }
+        },
+        mode);
+}
+
 int main()
 {
     const size_t dataSize = 800000;
@@ -144,5 +203,240 @@ int main()
     std::printf("Sum: %f\n", parSum.load());
     std::printf("Speedup: %fx\n", elapsedSerially.count() / elapsedParallel.count());
 
+    // ----- THREAD POOL -----
+
+    ThreadPool pool(numThreads);
+
+    auto poolData = std::make_unique<double[]>(dataSize);
+
+    std::print("Initialising arrays on thread pool...\n");
+
+    start = std::chrono::high_resolution_clock::now();
+    initialisePool(pool, poolData.get(), dataSize, 1.0);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedInitPool = end - start;
+
+    std::printf("Time for thread pool initialisation: %f seconds\n", elapsedInitPool.count());
+
+    std::print("Running on thread pool...\n");
+
+    start = std::chrono::high_resolution_clock::now();
+    double poolSum = processPool(pool, poolData.get(), dataSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedPool = end - start;
+
+    std::printf("Time for thread pool processing: %f seconds\n", elapsedPool.count());
+    std::printf("Sum: %f\n", poolSum);
+    std::printf("Speedup: %fx\n", elapsedSerially.count() / elapsedPool.count());
+
+    // ----- SIMD -----
+
+    std::printf("Running SIMD (%d doubles per instruction) on thread pool...\n", simd::packetSize);
+
+    initialisePool(pool, poolData.get(), dataSize, 1.0);
+
+    start = std::chrono::high_resolution_clock::now();
+    double simdSum = processPoolSimd(pool, poolData.get(), dataSize);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedSimd = end - start;
+
+    std::printf("Time for SIMD thread pool processing: %f seconds\n", elapsedSimd.count());
+    std::printf("Sum: %f\n", simdSum);
+    std::printf("Speedup: %fx (SIMD over scalar pool %fx)\n", elapsedSerially.count() / elapsedSimd.count(),
+                elapsedPool.count() / elapsedSimd.count());
+
+    // ----- REPRODUCIBLE SUMS -----
+
+    // The atomic sum above depends on the order in which the threads finish.
+    // The blocked pairwise sums give the same bits on any number of threads.
+
+    std::print("Running reproducible sums...\n");
+
+    double reference[2] = {0.0, 0.0};
+    bool identical = true;
+
+    for (int threads : {1, 2, 3, numThreads})
+    {
+        ThreadPool threadPool(threads);
+
+        for (Summation mode : {Summation::PLAIN, Summation::NEUMAIER})
+        {
+            initialisePool(threadPool, poolData.get(), dataSize, 1.0);
+
+            start = std::chrono::high_resolution_clock::now();
+            double sum = processReproducible(threadPool, poolData.get(), dataSize, mode);
+            end = std::chrono::high_resolution_clock::now();
+
+            std::chrono::duration<double> elapsed = end - start;
+
+            std::printf("%2d threads, %-8s: sum %.17g, %f seconds\n", threads,
+                        mode == Summation::PLAIN ? "plain" : "neumaier", sum, elapsed.count());
+
+            if (threads == 1)
+                reference[int(mode)] = sum;
+            else
+                identical = identical && (sum == reference[int(mode)]);
+        }
+    }
+
+    std::printf("Sums identical for all thread counts: %s\n", identical ? "yes" : "no");
+
+    // Summation alone, where the extra work of the reproducible sums shows.
+    // poolData holds the results of the last run.
+
+    const int repeats = 100;
+    double sink = 0.0;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeats; ++i)
+    {
+        std::atomic<double> atomicSum{0.0};
+        pool.parallelFor(0, dataSize, 0, [&](size_t first, size_t last) {
+            double localSum = 0.0;
+            for (size_t k = first; k < last; ++k)
+                localSum += poolData[k];
+            atomicSum += localSum;
+        });
+        sink += atomicSum.load();
+    }
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedAtomicSum = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeats; ++i)
+        sink += reproducibleSum(pool, poolData.get(), dataSize, Summation::PLAIN);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedPlainSum = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < repeats; ++i)
+        sink += reproducibleSum(pool, poolData.get(), dataSize, Summation::NEUMAIER);
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedNeumaierSum = end - start;
+
+    std::printf("Summing %zu values (%f):\n", dataSize, sink / (3 * repeats));
+    std::printf("  atomic:         %f ms\n", elapsedAtomicSum.count() / repeats * 1e3);
+    std::printf("  reproducible:   %f ms\n", elapsedPlainSum.count() / repeats * 1e3);
+    std::printf("  with Neumaier:  %f ms\n", elapsedNeumaierSum.count() / repeats * 1e3);
+
+    // ----- NUMA PLACEMENT -----
+
+    // The arrays above are placed wherever the initialising threads happened
+    // to run, and the threads are free to move. Here every chunk is placed on
+    // the node of the pinned thread that processes it in every pass, compared
+    // with pages interleaved over all nodes. The kernel is compute bound, so a
+    // memory bound pass (a += b over larger arrays) is timed as well.
+
+    numa::PinnedTeam team(numThreads);
+
+    std::printf("NUMA nodes: %d\n", numa::topology().nodeCount);
+
+    if (numa::topology().nodeCount == 1)
+        std::print("Single NUMA node, both placements are the same.\n");
+
+    const size_t streamSize = 16 * 1024 * 1024;
+    const int streamRepeats = 10;
+
+    for (numa::Placement placement : {numa::Placement::LOCAL, numa::Placement::INTERLEAVED})
+    {
+        const char *name = placement == numa::Placement::LOCAL ? "local" : "interleaved";
+
+        numa::Array<double> numaData(team, dataSize, placement, 1.0);
+
+        start = std::chrono::high_resolution_clock::now();
+        double numaSum = team.parallelReduce(
+            dataSize, 0.0,
+            [&numaData](size_t first, size_t last) {
+                double localSum = 0.0;
+                for (size_t i = first; i < last; ++i)
+                {
+                    numaData[i] = heavyElement(numaData[i]);
+                    localSum += numaData[i];
+                }
+                return localSum;
+            },
+            [](double a, double b) { return a + b; });
+        end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double> elapsedNuma = end - start;
+
+        numa::Array<double> a(team, streamSize, placement, 1.0);
+        numa::Array<double> b(team, streamSize, placement, 2.0);
+
+        double streamSum = 0.0;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < streamRepeats; ++i)
+        {
+            streamSum += team.parallelReduce(
+                streamSize, 0.0,
+                [&a, &b](size_t first, size_t last) {
+                    double localSum = 0.0;
+                    for (size_t k = first; k < last; ++k)
+                    {
+                        a[k] += b[k];
+                        localSum += a[k];
+                    }
+                    return localSum;
+                },
+                [](double x, double y) { return x + y; });
+        }
+        end = std::chrono::high_resolution_clock::now();
+
+        std::chrono::duration<double> elapsedStream = end - start;
+
+        // Reads a and b and writes a
+        double bytes = 3.0 * sizeof(double) * double(streamSize) * streamRepeats;
+
+        std::printf("%-11s: kernel %f seconds (sum %f), a += b %.2f GB/s (sum %g)\n", name, elapsedNuma.count(), numaSum,
+                    bytes / elapsedStream.count() * 1e-9, streamSum);
+
+        std::vector<size_t> pages = a.pagesPerNode();
+
+        if (!pages.empty())
+        {
+            std::printf("%-11s: sampled pages per node:", name);
+            for (size_t node = 0; node < pages.size(); ++node)
+                std::printf(" %zu", pages[node]);
+            std::printf("\n");
+        }
+    }
+
+    // ----- MANY SMALL CALLS -----
+
+    const size_t callSize = 100;
+    const int calls = 2000;
+
+    std::printf("Running %d calls of %zu elements...\n", calls, callSize);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        initialiseParallel(parData.get(), callSize, 1.0);
+        processParallel(parData.get(), callSize, numThreads, parSum);
+    }
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedSpawnCalls = end - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; ++i)
+    {
+        initialisePool(pool, poolData.get(), callSize, 1.0);
+        poolSum = processPool(pool, poolData.get(), callSize);
+    }
+    end = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> elapsedPoolCalls = end - start;
+
+    std::printf("Time per call, threads per call: %f us\n", elapsedSpawnCalls.count() / calls * 1e6);
+    std::printf("Time per call, thread pool: %f us\n", elapsedPoolCalls.count() / calls * 1e6);
+
     return 0;
 }
@@ -0,0 +1,529 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+// A single CSV row. The fields are views into the mapped file and are only
+// valid as long as the reader that produced the row is open.
+
+class CsvRow {
+private:
+    std::string_view m_line;
+    char m_delimiter = ',';
+
+public:
+    CsvRow() = default;
+
+    CsvRow(std::string_view line, char delimiter) : m_line(line), m_delimiter(delimiter)
+    {
+    }
+
+    std::string_view line() const
+    {
+        return m_line;
+    }
+
+    // Returns field number index, or an empty view if the row is shorter
+    std::string_view field(std::size_t index) const
+    {
+        std::size_t start = 0;
+
+        for (std::size_t i = 0; i < index; ++i)
+        {
+            start = m_line.find(m_delimiter, start);
+            if (start == std::string_view::npos)
+                return std::string_view();
+            ++start;
+        }
+
+        std::size_t end = m_line.find(m_delimiter, start);
+
+        if (end == std::string_view::npos)
+            end = m_line.size();
+
+        return m_line.substr(start, end - start);
+    }
+
+    std::size_t fieldCount() const
+    {
+        return m_line.empty() ? 0 : 1 + std::size_t(std::count(m_line.begin(), m_line.end(), m_delimiter));
+    }
+};
+
+// Columns of a parsed "timestamp,value" file, time in seconds since
+// 1970-01-01 00:00:00
+
+struct TimeSeries {
+    std::vector< std::int64_t > time;
+    std::vector< double > value;
+
+    std::size_t size() const
+    {
+        return time.size();
+    }
+
+    void clear()
+    {
+        time.clear();
+        value.clear();
+    }
+
+    void add(std::int64_t t, double v)
+    {
+        time.push_back(t);
+        value.push_back(v);
+    }
+};
+
+// Zero-copy reader for delimited text files such as data/AEP_hourly.csv.
+// The file is memory mapped and rows are handed out as string_views into
+// the mapping, so iterating over a file does not allocate. Numbers are
+// parsed with std::from_chars, which neither allocates nor depends on the
+// locale, and timestamps in the fixed "YYYY-MM-DD HH:MM:SS" format take a
+// fast path that reads the digits directly.
+//
+// Two ways of reading:
+//
+//   for (const CsvRow &row : reader)            // any layout
+//       ... row.field(0) ... row.field(1) ...
+//
+//   reader.forEach([](std::int64_t time, double value) { ... });
+//
+// forEach() is specialised for the "timestamp,value" layout of the hourly
+// series, with time in seconds since 1970-01-01 00:00:00.
+
+class CsvReader {
+private:
+    MappedFile m_file;
+    std::string_view m_header;
+    std::string_view m_body;
+    char m_delimiter;
+    std::size_t m_errors = 0;
+
+    // Returns the line starting at pos without its line ending and advances
+    // pos past the line ending
+    static std::string_view nextLine(const char *&pos, const char *end)
+    {
+        const char *first = pos;
+        const char *last = static_cast< const char * >(std::memchr(first, '\n', std::size_t(end - first)));
+
+        if (last == nullptr)
+        {
+            last = end;
+            pos = end;
+        }
+        else
+            pos = last + 1;
+
+        if ((last > first) && (last[-1] == '\r'))
+            --last;
+
+        return std::string_view(first, std::size_t(last - first));
+    }
+
+public:
+    class Iterator {
+    private:
+        const char *m_pos = nullptr;
+        const char *m_end = nullptr;
+        char m_delimiter = ',';
+        CsvRow m_row;
+
+        void advance()
+        {
+            // Skip empty lines, such as a trailing newline at end of file
+
+            while (m_pos != m_end)
+            {
+                std::string_view line = nextLine(m_pos, m_end);
+
+                if (!line.empty())
+                {
+                    m_row = CsvRow(line, m_delimiter);
+                    return;
+                }
+            }
+
+            m_pos = nullptr;
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = CsvRow;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const CsvRow *;
+        using reference = const CsvRow &;
+
+        Iterator() = default;
+
+        Iterator(std::string_view text, char delimiter)
+            : m_pos(text.data()), m_end(text.data() + text.size()), m_delimiter(delimiter)
+        {
+            if (m_pos != nullptr)
+                advance();
+        }
+
+        reference operator*() const
+        {
+            return m_row;
+        }
+
+        pointer operator->() const
+        {
+            return &m_row;
+        }
+
+        Iterator &operator++()
+        {
+            advance();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            advance();
+            return previous;
+        }
+
+        // Rows are identified by where they end, end() has m_pos == nullptr
+        bool operator==(const Iterator &other) const
+        {
+            return m_pos == other.m_pos;
+        }
+    };
+
+    CsvReader(char delimiter = ',') : m_delimiter(delimiter)
+    {
+    }
+
+    // Maps the file. With hasHeader the first line is available through
+    // header() and is not returned as a row.
+    bool open(const std::string &filename, bool hasHeader = true)
+    {
+        m_errors = 0;
+        m_header = std::string_view();
+        m_body = std::string_view();
+
+        if (!m_file.open(filename))
+            return false;
+
+        const char *pos = m_file.data();
+        const char *end = pos + m_file.size();
+
+        if (hasHeader && (pos != end))
+            m_header = nextLine(pos, end);
+
+        m_body = std::string_view(pos, std::size_t(end - pos));
+
+        return true;
+    }
+
+    void close()
+    {
+        m_file.close();
+        m_header = std::string_view();
+        m_body = std::string_view();
+    }
+
+    bool isOpen() const
+    {
+        return m_file.isOpen();
+    }
+
+    CsvRow header() const
+    {
+        return CsvRow(m_header, m_delimiter);
+    }
+
+    // Size of the mapped file in bytes
+    std::size_t size() const
+    {
+        return m_file.size();
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(m_body, m_delimiter);
+    }
+
+    Iterator end() const
+    {
+        return Iterator();
+    }
+
+    // Calls visitor(time, value) for every "timestamp,value" row and returns
+    // the number of rows visited. Rows that can not be parsed are skipped
+    // and counted in errors().
+    template < typename Visitor > std::size_t forEach(Visitor &&visitor)
+    {
+        m_errors = 0;
+        return parseRows(m_body, m_delimiter, visitor, m_errors);
+    }
+
+    // Parses all "timestamp,value" rows into series and returns the number
+    // of rows. With more than one thread the file is split into byte ranges
+    // that are realigned to line starts and parsed concurrently into
+    // per-thread columns, which are then copied into series in file order,
+    // so the result is identical to the serial parse.
+    //
+    // The threads are created for each call, not taken from a pool, which
+    // keeps this chapter independent of the thread pool in ch_concurrency.
+    // Starting them costs tens of microseconds, small next to parsing a file
+    // large enough to be worth splitting. Use threads = 1 for small files.
+    std::size_t read(TimeSeries &series, int threads = 1)
+    {
+        m_errors = 0;
+        series.clear();
+
+        if (threads <= 1)
+        {
+            series.time.reserve(m_body.size() / 16);
+            series.value.reserve(m_body.size() / 16);
+
+            auto add = [&series](std::int64_t t, double v) { series.add(t, v); };
+            return parseRows(m_body, m_delimiter, add, m_errors);
+        }
+
+        std::vector< std::string_view > chunks = splitLines(m_body, threads);
+        std::vector< TimeSeries > parts(chunks.size());
+        std::vector< std::size_t > errors(chunks.size(), 0);
+
+        auto parse = [this, &chunks, &parts, &errors](std::size_t k) {
+            parts[k].time.reserve(chunks[k].size() / 16);
+            parts[k].value.reserve(chunks[k].size() / 16);
+
+            auto add = [&part = parts[k]](std::int64_t t, double v) { part.add(t, v); };
+            parseRows(chunks[k], m_delimiter, add, errors[k]);
+        };
+
+        {
+            std::vector< std::jthread > workers;
+            for (std::size_t k = 0; k < chunks.size(); ++k)
+                workers.emplace_back(parse, k);
+        }
+
+        // Concatenate in file order, each thread copies its own part
+
+        std::vector< std::size_t > offsets(parts.size() + 1, 0);
+
+        for (std::size_t k = 0; k < parts.size(); ++k)
+        {
+            offsets[k + 1] = offsets[k] + parts[k].size();
+            m_errors += errors[k];
+        }
+
+        series.time.resize(offsets.back());
+        series.value.resize(offsets.back());
+
+        auto copy = [&parts, &offsets, &series](std::size_t k) {
+            std::copy(parts[k].time.begin(), parts[k].time.end(), series.time.begin() + offsets[k]);
+            std::copy(parts[k].value.begin(), parts[k].value.end(), series.value.begin() + offsets[k]);
+            parts[k] = TimeSeries();
+        };
+
+        {
+            std::vector< std::jthread > workers;
+            for (std::size_t k = 0; k < parts.size(); ++k)
+                workers.emplace_back(copy, k);
+        }
+
+        return series.size();
+    }
+
+    // Splits text into at most parts ranges of roughly equal size. Every
+    // range except the first is moved forward to the start of the next
+    // line, so no line is split between two ranges.
+    static std::vector< std::string_view > splitLines(std::string_view text, int parts)
+    {
+        std::vector< std::string_view > chunks;
+
+        const char *begin = text.data();
+        const char *end = begin + text.size();
+        const char *first = begin;
+
+        for (int k = 1; k <= parts; ++k)
+        {
+            const char *last = end;
+
+            if (k < parts)
+            {
+                last = begin + text.size() * std::size_t(k) / std::size_t(parts);
+
+                if (last < first)
+                    last = first;
+
+                if (last != begin)
+                {
+                    // A range ending right after a newline is already aligned
+                    const char *newline = static_cast< const char * >(
+                        std::memchr(last - 1, '\n', std::size_t(end - (last - 1))));
+                    last = (newline == nullptr) ? end : newline + 1;
+                }
+            }
+
+            if (last != first)
+                chunks.push_back(std::string_view(first, std::size_t(last - first)));
+
+            first = last;
+        }
+
+        return chunks;
+    }
+
+    // Number of rows skipped by the last forEach() or read()
+    std::size_t errors() const
+    {
+        return m_errors;
+    }
+
+    // Parses the "timestamp,value" rows of text, which must start at the
+    // beginning of a line
+    template < typename Visitor >
+    static std::size_t parseRows(std::string_view text, char delimiter, Visitor &visitor, std::size_t &errors)
+    {
+        const char *pos = text.data();
+        const char *end = pos + text.size();
+        std::size_t count = 0;
+
+        while (pos != end)
+        {
+            std::string_view line = nextLine(pos, end);
+
+            if (line.empty())
+                continue;
+
+            std::size_t split = line.find(delimiter);
+            std::int64_t time;
+            double value;
+
+            if ((split == std::string_view::npos) || !parseDateTime(line.substr(0, split), time) ||
+                !parseDouble(line.substr(split + 1), value))
+            {
+                ++errors;
+                continue;
+            }
+
+            visitor(time, value);
+            ++count;
+        }
+
+        return count;
+    }
+
+    static bool parseDouble(std::string_view text, double &value)
+    {
+        const char *first = text.data();
+        const char *last = first + text.size();
+
+        if ((first != last) && (*first == '+')) // from_chars does not accept a leading +
+            ++first;
+
+        auto [ptr, ec] = std::from_chars(first, last, value);
+
+        return (ec == std::errc()) && (ptr == last);
+    }
+
+    // Parses "YYYY-MM-DD HH:MM:SS" into seconds since 1970-01-01 00:00:00.
+    // Other separators and field widths, such as "2004-1-5T1:00", go
+    // through a slower general path.
+    static bool parseDateTime(std::string_view text, std::int64_t &seconds)
+    {
+        int year, month, day, hour = 0, minute = 0, second = 0;
+
+        if ((text.size() == 19) && (text[4] == '-') && (text[7] == '-') && (text[10] == ' ') &&
+            (text[13] == ':') && (text[16] == ':'))
+        {
+            auto digits = [&text](int pos, int count, int &value) {
+                value = 0;
+                for (int i = pos; i < pos + count; ++i)
+                {
+                    unsigned d = unsigned(text[i]) - unsigned('0');
+                    if (d > 9)
+                        return false;
+                    value = 10 * value + int(d);
+                }
+                return true;
+            };
+
+            if (!(digits(0, 4, year) && digits(5, 2, month) && digits(8, 2, day) && digits(11, 2, hour) &&
+                  digits(14, 2, minute) && digits(17, 2, second)))
+                return false;
+        }
+        else
+        {
+            const char *pos = text.data();
+            const char *end = pos + text.size();
+
+            auto number = [&pos, end](int &value) {
+                auto [ptr, ec] = std::from_chars(pos, end, value);
+                pos = ptr;
+                return ec == std::errc();
+            };
+
+            auto separator = [&pos, end](char a, char b) {
+                if ((pos == end) || ((*pos != a) && (*pos != b)))
+                    return false;
+                ++pos;
+                return true;
+            };
+
+            if (!(number(year) && separator('-', '-') && number(month) && separator('-', '-') && number(day)))
+                return false;
+
+            // Time of day is optional, seconds as well
+
+            if ((pos != end) && !(separator(' ', 'T') && number(hour) && separator(':', ':') && number(minute)))
+                return false;
+
+            if ((pos != end) && !(separator(':', ':') && number(second)))
+                return false;
+
+            if (pos != end)
+                return false;
+        }
+
+        using namespace std::chrono;
+
+        year_month_day date{std::chrono::year(year), std::chrono::month(unsigned(month)),
+                            std::chrono::day(unsigned(day))};
+
+        if (!date.ok() || (hour < 0) || (hour > 23) || (minute < 0) || (minute > 59) || (second < 0) || (second > 60))
+            return false;
+
+        seconds = std::int64_t(sys_days(date).time_since_epoch().count()) * 86400 + hour * 3600 + minute * 60 +
+                  second;
+
+        return true;
+    }
+
+    // Inverse of parseDateTime, formats as "YYYY-MM-DD HH:MM:SS"
+    static std::string formatDateTime(std::int64_t seconds)
+    {
+        using namespace std::chrono;
+
+        std::int64_t days = seconds / 86400 - ((seconds % 86400) < 0 ? 1 : 0);
+        std::int64_t time = seconds - days * 86400;
+
+        year_month_day date{sys_days(std::chrono::days(days))};
+
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u %02d:%02d:%02d", int(date.year()),
+                      unsigned(date.month()), unsigned(date.day()), int(time / 3600), int(time / 60 % 60),
+                      int(time % 60));
+
+        return buffer;
+    }
+};
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "csv_reader.h"
+
+using namespace std;
+
+// Same parsing as files9.cpp (getline, substr and stod), without the output
+double readWithGetline(const string &filename, size_t &rows, double &sum)
+{
+    auto start = chrono::high_resolution_clock::now();
+
+    string line;
+    ifstream infile(filename);
+
+    rows = 0;
+    sum = 0.0;
+
+    getline(infile, line); // Header
+
+    while (getline(infile, line))
+    {
+        auto pos = std::find(line.begin(), line.end(), ',');
+
+        if (pos != line.end())
+        {
+            string date = line.substr(0, pos - line.begin());
+            string strValue = line.substr(pos - line.begin() + 1);
+
+            try
+            {
+                sum += std::stod(strValue);
+                rows++;
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << '\n';
+            }
+        }
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration< double >(end - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    string filename = "../data/AEP_hourly.csv";
+
+    if (argc > 1)
+        filename = argv[1];
+
+    CsvReader reader;
+
+    if (!reader.open(filename))
+    {
+        cout << "Error opening file" << endl;
+        return 1;
+    }
+
+    // Row iteration, fields are string_views into the mapped file
+
+    cout << "columns: " << reader.header().field(0) << ", " << reader.header().field(1) << "\n";
+
+    int shown = 0;
+
+    for (const CsvRow &row : reader)
+    {
+        cout << "date:  " << row.field(0) << " value: " << row.field(1) << "\n";
+
+        if (++shown == 5)
+            break;
+    }
+
+    // Visitor, timestamp and value parsed in place
+
+    auto start = chrono::high_resolution_clock::now();
+
+    double sum = 0.0;
+    double maxValue = -1e300;
+    int64_t maxTime = 0;
+    int64_t firstTime = INT64_MAX;
+    int64_t lastTime = INT64_MIN;
+
+    size_t rows = reader.forEach([&](int64_t time, double value) {
+        sum += value;
+        firstTime = std::min(firstTime, time);
+        lastTime = std::max(lastTime, time);
+
+        if (value > maxValue)
+        {
+            maxValue = value;
+            maxTime = time;
+        }
+    });
+
+    auto end = chrono::high_resolution_clock::now();
+    double mappedTime = chrono::duration< double >(end - start).count();
+
+    cout << "\nrows: " << rows << ", skipped: " << reader.errors() << "\n";
+    cout << "mean: " << sum / double(rows) << " MW\n";
+    cout << "span: " << CsvReader::formatDateTime(firstTime) << " to " << CsvReader::formatDateTime(lastTime)
+         << "\n";
+    cout << "peak: " << maxValue << " MW at " << CsvReader::formatDateTime(maxTime) << "\n";
+
+    // Comparison with the getline version
+
+    size_t getlineRows;
+    double getlineSum;
+    double getlineTime = readWithGetline(filename, getlineRows, getlineSum);
+
+    double megabytes = double(reader.size()) / 1e6;
+
+    cout << fixed << setprecision(3);
+    cout << "\nmapped + from_chars: " << setw(8) << mappedTime << " s " << setw(10) << megabytes / mappedTime
+         << " MB/s\n";
+    cout << "getline + stod:      " << setw(8) << getlineTime << " s " << setw(10) << megabytes / getlineTime
+         << " MB/s\n";
+    cout << "same result: " << (((rows == getlineRows) && (sum == getlineSum)) ? "yes" : "no") << "\n";
+
+    reader.close();
+}
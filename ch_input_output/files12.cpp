@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "csv_reader.h"
+
+using namespace std;
+
+// Parallel parsing of the hourly series. Reports MB/s of CsvReader::read()
+// for 1..N threads against the getline loop of files9.cpp. The sample file
+// is small; pass a larger file in the same format as the first argument
+// for more meaningful numbers.
+
+template < typename F > double timeIt(F f, int repeats = 5)
+{
+    double best = 1e300;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        auto start = chrono::high_resolution_clock::now();
+        f();
+        auto end = chrono::high_resolution_clock::now();
+        best = std::min(best, chrono::duration< double >(end - start).count());
+    }
+
+    return best;
+}
+
+vector< int > threadCounts()
+{
+    vector< int > counts;
+    int maxThreads = std::max(1u, thread::hardware_concurrency());
+
+    for (int n = 1; n < maxThreads; n *= 2)
+        counts.push_back(n);
+
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+void readWithGetline(const string &filename, TimeSeries &series)
+{
+    string line;
+    ifstream infile(filename);
+
+    series.clear();
+
+    getline(infile, line); // Header
+
+    while (getline(infile, line))
+    {
+        auto pos = std::find(line.begin(), line.end(), ',');
+
+        if (pos != line.end())
+        {
+            string date = line.substr(0, pos - line.begin());
+            string strValue = line.substr(pos - line.begin() + 1);
+
+            try
+            {
+                int64_t time;
+                if (CsvReader::parseDateTime(date, time))
+                    series.add(time, std::stod(strValue));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << e.what() << '\n';
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string filename = "../data/AEP_hourly.csv";
+
+    if (argc > 1)
+        filename = argv[1];
+
+    CsvReader reader;
+
+    if (!reader.open(filename))
+    {
+        cout << "Error opening file" << endl;
+        return 1;
+    }
+
+    double megabytes = double(reader.size()) / 1e6;
+
+    TimeSeries reference;
+    reader.read(reference);
+
+    cout << filename << ": " << megabytes << " MB, " << reference.size() << " rows\n\n";
+    cout << fixed << setprecision(3);
+    cout << setw(10) << "threads" << setw(12) << "time [s]" << setw(12) << "MB/s" << setw(10) << "speedup\n";
+
+    TimeSeries series;
+
+    double tGetline = timeIt([&]() { readWithGetline(filename, series); });
+
+    bool identical = (series.time == reference.time) && (series.value == reference.value);
+
+    cout << setw(10) << "getline" << setw(12) << tGetline << setw(12) << megabytes / tGetline << setw(10) << 1.0
+         << (identical ? "" : " (differs)") << "\n";
+
+    for (auto nThreads : threadCounts())
+    {
+        double t = timeIt([&]() { reader.read(series, nThreads); });
+
+        identical = (series.time == reference.time) && (series.value == reference.value);
+
+        cout << setw(10) << nThreads << setw(12) << t << setw(12) << megabytes / t << setw(10) << tGetline / t
+             << (identical ? "" : " (differs)") << "\n";
+    }
+
+    reader.close();
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "csv_reader.h"
+#include "time_series_cache.h"
+
+using namespace std;
+
+// The first run parses the CSV file and writes a columnar cache next to it.
+// Later runs map the cache instead, unless the CSV file is newer.
+
+int main(int argc, char *argv[])
+{
+    string filename = "../data/AEP_hourly.csv";
+
+    if (argc > 1)
+        filename = argv[1];
+
+    string cacheFilename = filesystem::path(filename).replace_extension(".tsc").string();
+
+    bool stale = !filesystem::exists(cacheFilename) ||
+                 (filesystem::last_write_time(cacheFilename) < filesystem::last_write_time(filename));
+
+    if (stale)
+    {
+        auto start = chrono::high_resolution_clock::now();
+
+        CsvReader reader;
+
+        if (!reader.open(filename))
+        {
+            cout << "Error opening file" << endl;
+            return 1;
+        }
+
+        TimeSeries series;
+        reader.read(series);
+
+        if (!TimeSeriesCache::write(cacheFilename, series))
+        {
+            cout << "Error writing cache" << endl;
+            return 1;
+        }
+
+        auto end = chrono::high_resolution_clock::now();
+
+        cout << "Parsed " << filename << " and wrote " << cacheFilename << " in "
+             << chrono::duration< double >(end - start).count() << " s\n";
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+
+    TimeSeriesCache cache;
+
+    if (!cache.open(cacheFilename))
+    {
+        cout << "Error opening cache" << endl;
+        return 1;
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+
+    cout << "Opened " << cacheFilename << " in " << chrono::duration< double >(end - start).count() * 1e6
+         << " us, " << cache.size() << " rows in " << cache.blocks().size() << " blocks\n\n";
+
+    // Time range query, mean load during 2010
+
+    int64_t first, last;
+    CsvReader::parseDateTime("2010-01-01 00:00:00", first);
+    CsvReader::parseDateTime("2011-01-01 00:00:00", last);
+
+    double sum = 0.0;
+    size_t blocksRead;
+
+    size_t rows = cache.forEachInRange(first, last, [&sum](int64_t, double value) { sum += value; }, &blocksRead);
+
+    cout << fixed << setprecision(1);
+    cout << "2010: " << rows << " hours, mean " << sum / double(rows) << " MW, read " << blocksRead << " of "
+         << cache.blocks().size() << " blocks\n";
+
+    // Value query, hours with a load of at least 25000 MW
+
+    rows = cache.forEachAbove(
+        25000.0,
+        [](int64_t time, double value) { cout << "  " << CsvReader::formatDateTime(time) << " " << value << " MW\n"; },
+        &blocksRead);
+
+    cout << ">= 25000 MW: " << rows << " hours, read " << blocksRead << " of " << cache.blocks().size()
+         << " blocks\n";
+
+    cache.close();
+}
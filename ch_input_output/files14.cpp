@@ -0,0 +1,143 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "csv_reader.h"
+#include "time_series_stream.h"
+
+using namespace std;
+
+// Streaming aggregation of the hourly load series in a single pass over the
+// file. Within every year the file lists the days in descending order, so
+// the reorder buffer has to hold up to a year of samples (about 8800) to
+// restore time order. All other stages only keep their current period or
+// window in memory.
+
+int main(int argc, char *argv[])
+{
+    string filename = "../data/AEP_hourly.csv";
+
+    if (argc > 1)
+        filename = argv[1];
+
+    CsvReader reader;
+
+    if (!reader.open(filename))
+    {
+        cout << "Error opening file" << endl;
+        return 1;
+    }
+
+    const int64_t hour = 3600;
+    const int64_t day = 24 * hour;
+
+    // Yearly table, peak day and peak month
+
+    cout << fixed << setprecision(1);
+    cout << setw(6) << "year" << setw(8) << "hours" << setw(10) << "mean" << setw(10) << "min" << setw(10) << "max"
+         << "  [MW]\n";
+
+    Resampler yearly(Period::YEAR, [](int64_t start, const Summary &s) {
+        cout << setw(6) << CsvReader::formatDateTime(start).substr(0, 4) << setw(8) << s.count << setw(10)
+             << s.mean() << setw(10) << s.min << setw(10) << s.max << "\n";
+    });
+
+    int64_t peakDay = 0, peakMonth = 0;
+    double peakDayMean = 0.0, peakMonthMean = 0.0;
+
+    Resampler daily(Period::DAY, [&](int64_t start, const Summary &s) {
+        if (s.mean() > peakDayMean)
+        {
+            peakDayMean = s.mean();
+            peakDay = start;
+        }
+    });
+
+    Resampler monthly(Period::MONTH, [&](int64_t start, const Summary &s) {
+        if (s.mean() > peakMonthMean)
+        {
+            peakMonthMean = s.mean();
+            peakMonth = start;
+        }
+    });
+
+    // Rolling peaks, 24 hour mean and 7 day maximum
+
+    int64_t peak24Time = 0;
+    double peak24Mean = 0.0;
+
+    RollingWindow rolling24(day, [&](int64_t time, const Summary &s) {
+        if ((s.count >= 20) && (s.mean() > peak24Mean))
+        {
+            peak24Mean = s.mean();
+            peak24Time = time;
+        }
+    });
+
+    double weekRangeMax = 0.0;
+    int64_t weekRangeTime = 0;
+
+    RollingWindow rollingWeek(7 * day, [&](int64_t time, const Summary &s) {
+        if (s.max - s.min > weekRangeMax)
+        {
+            weekRangeMax = s.max - s.min;
+            weekRangeTime = time;
+        }
+    });
+
+    // Profiles, fed in file order since they do not depend on it
+
+    GroupBy byHour(GroupKey::HOUR_OF_DAY);
+    GroupBy byWeekday(GroupKey::DAY_OF_WEEK);
+
+    ReorderBuffer reorder(366 * day, [&](int64_t time, double value) {
+        yearly.add(time, value);
+        monthly.add(time, value);
+        daily.add(time, value);
+        rolling24.add(time, value);
+        rollingWeek.add(time, value);
+    });
+
+    auto start = chrono::high_resolution_clock::now();
+
+    size_t rows = reader.forEach([&](int64_t time, double value) {
+        reorder.add(time, value);
+        byHour.add(time, value);
+        byWeekday.add(time, value);
+    });
+
+    reorder.finish();
+    yearly.finish();
+    monthly.finish();
+    daily.finish();
+
+    auto end = chrono::high_resolution_clock::now();
+    double elapsed = chrono::duration< double >(end - start).count();
+
+    cout << "\npeak day:    " << CsvReader::formatDateTime(peakDay).substr(0, 10) << ", mean " << peakDayMean
+         << " MW\n";
+    cout << "peak month:  " << CsvReader::formatDateTime(peakMonth).substr(0, 7) << ", mean " << peakMonthMean
+         << " MW\n";
+    cout << "peak 24 h:   ending " << CsvReader::formatDateTime(peak24Time) << ", mean " << peak24Mean << " MW\n";
+    cout << "widest week: ending " << CsvReader::formatDateTime(weekRangeTime) << ", max - min " << weekRangeMax
+         << " MW\n";
+
+    cout << "\nhour   mean [MW]\n";
+    for (size_t h = 0; h < byHour.size(); h++)
+        cout << setw(4) << h << setw(12) << byHour[h].mean() << "\n";
+
+    const char *weekdays[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+    cout << "\nday    mean [MW]\n";
+    for (size_t d = 0; d < byWeekday.size(); d++)
+        cout << setw(4) << weekdays[d] << setw(12) << byWeekday[d].mean() << "\n";
+
+    cout << "\n"
+         << rows << " rows, " << reorder.duplicates() << " duplicate timestamps, " << reorder.dropped()
+         << " dropped, at most " << reorder.maxPending() << " samples buffered\n";
+    cout << setprecision(3) << "parse and aggregate: " << elapsed << " s, "
+         << double(reader.size()) / 1e6 / elapsed << " MB/s\n";
+
+    reader.close();
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "vit_raster.h"
+
+using namespace std;
+
+// Reads data/colorado_elev.vit through VitRaster: header information, a
+// small window around the centre and per-tile statistics computed with a
+// single tile-sized buffer.
+
+int main(int argc, char *argv[])
+{
+    string filename = "../data/colorado_elev.vit";
+
+    if (argc > 1)
+        filename = argv[1];
+
+    VitRaster raster;
+
+    if (!raster.open(filename))
+    {
+        cout << "Error opening file" << endl;
+        return 1;
+    }
+
+    const char *typeNames[] = {"uint8", "int16", "uint16", "float32"};
+
+    cout << filename << ": " << raster.width() << " x " << raster.height() << ", "
+         << typeNames[int(raster.pixelType())] << " (type code " << raster.typeCode() << "), pixels at offset "
+         << raster.dataOffset() << "\n\n";
+
+    // Window around the centre
+
+    vector< float > buffer;
+    auto window = raster.readWindow(raster.height() / 2 - 4, raster.width() / 2 - 4, 8, 8, buffer);
+
+    cout << "8 x 8 window at (" << window.row << ", " << window.col << "):\n";
+
+    for (size_t i = 0; i < window.rows; i++)
+    {
+        for (size_t j = 0; j < window.cols; j++)
+            cout << setw(5) << window(i, j);
+        cout << "\n";
+    }
+
+    // Mean of every 100 x 100 tile
+
+    const size_t tileSize = 100;
+
+    cout << "\nmean per " << tileSize << " x " << tileSize << " tile:\n";
+
+    float minValue = 1e30f, maxValue = -1e30f;
+
+    raster.forEachTile(tileSize, tileSize, [&](const VitRaster::Tile &tile) {
+        double sum = 0.0;
+
+        for (float value : tile.data)
+        {
+            sum += value;
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+
+        cout << fixed << setprecision(1) << setw(8) << sum / double(tile.data.size());
+
+        if (tile.col + tile.cols == raster.width())
+            cout << "\n";
+    });
+
+    cout << "\nrange: " << minValue << " - " << maxValue << "\n";
+
+    raster.close();
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vit_raster.h"
+
+using namespace std;
+
+// Exports data/colorado_elev.vit as CSV and .npy for plot_colorado.py and
+// compares the export paths on a synthetic N x N raster (default 10000).
+
+// Per-pixel stream output, as in files10.cpp
+void saveCsvStream(const VitRaster &raster, const string &filename)
+{
+    ofstream outfile(filename, ios::out);
+
+    for (size_t i = 0; i < raster.height(); i++)
+    {
+        auto row = raster.rawRow(i);
+
+        for (size_t j = 0; j < raster.width(); j++)
+            outfile << static_cast< int >(row[j]) << ",";
+        outfile << "\n";
+    }
+}
+
+template < typename F > double timeIt(F f)
+{
+    auto start = chrono::high_resolution_clock::now();
+    f();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration< double >(end - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t N = 10000;
+
+    if (argc > 1)
+        N = std::stoul(argv[1]);
+
+    VitRaster raster;
+
+    if (!raster.open("../data/colorado_elev.vit"))
+    {
+        cout << "Error opening file" << endl;
+        return 1;
+    }
+
+    if (!raster.saveCsv("../data/colorado_elev.csv") || !raster.saveNpy("../data/colorado_elev.npy"))
+    {
+        cout << "Error writing file" << endl;
+        return 1;
+    }
+
+    cout << "Wrote ../data/colorado_elev.csv and ../data/colorado_elev.npy\n\n";
+
+    raster.close();
+
+    // Synthetic raster
+
+    vector< uint8_t > pixels(N * N);
+
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = 0; j < N; j++)
+            pixels[i * N + j] = uint8_t(127.5 + 127.5 * sin(0.01 * double(i)) * cos(0.013 * double(j)));
+
+    string benchFile = "raster_bench.vit";
+
+    if (!VitRaster::write(benchFile, N, N, pixels) || !raster.open(benchFile))
+    {
+        cout << "Error writing " << benchFile << endl;
+        return 1;
+    }
+
+    pixels = vector< uint8_t >();
+
+    double tStream = timeIt([&]() { saveCsvStream(raster, "raster_stream.csv"); });
+    double tCsv = timeIt([&]() { raster.saveCsv("raster_bench.csv"); });
+    double tNpy = timeIt([&]() { raster.saveNpy("raster_bench.npy"); });
+
+    // The stream version ends every line with an extra delimiter
+    bool sameText = filesystem::file_size("raster_stream.csv") == filesystem::file_size("raster_bench.csv") + N;
+
+    cout << N << " x " << N << " raster\n";
+    cout << fixed << setprecision(3);
+    cout << "ofstream <<  " << setw(10) << tStream << " s\n";
+    cout << "saveCsv      " << setw(10) << tCsv << " s, " << setw(8) << setprecision(1) << tStream / tCsv
+         << "x faster" << (sameText ? "" : " (size differs)") << "\n";
+    cout << setprecision(3) << "saveNpy      " << setw(10) << tNpy << " s, " << setw(8) << setprecision(1)
+         << tStream / tNpy << "x faster\n";
+
+    raster.close();
+
+    for (auto file : {"raster_bench.vit", "raster_stream.csv", "raster_bench.csv", "raster_bench.npy"})
+        filesystem::remove(file);
+}
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "particle_store.h"
+
+using namespace std;
+
+// Writes N particles (default 10^6) in both layouts of the particle store
+// and compares with one ofstream::write per record as in files5.cpp, then
+// maps the files for random access and a parallel reduction.
+
+template < typename F > double timeIt(F f)
+{
+    auto start = chrono::high_resolution_clock::now();
+    f();
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration< double >(end - start).count();
+}
+
+struct Moments {
+    double mass = 0.0;
+    double mx = 0.0;
+    double my = 0.0;
+};
+
+int main(int argc, char *argv[])
+{
+    size_t N = 1000000;
+
+    if (argc > 1)
+        N = std::stoul(argv[1]);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> pos(0.0, 100.0);
+    std::uniform_real_distribution<> mass(1.0, 2.0);
+
+    vector< Particle > particles(N);
+
+    for (auto &p : particles)
+        p = Particle{pos(gen), pos(gen), mass(gen)};
+
+    cout << N << " particles\n\n" << fixed << setprecision(3);
+
+    // Writing
+
+    double tStream = timeIt([&]() {
+        ofstream particlesFile("particles.dat", ios::out | ios::binary);
+        for (const auto &p : particles)
+            particlesFile.write((char *)&p, sizeof(p));
+    });
+
+    cout << "ofstream per record   " << setw(10) << tStream << " s\n";
+
+    for (auto layout : {ParticleLayout::AOS, ParticleLayout::SOA})
+    {
+        string name = layout == ParticleLayout::AOS ? "particles_aos.dat" : "particles_soa.dat";
+
+        double t = timeIt([&]() {
+            ParticleWriter writer;
+
+            if (!writer.open(name, layout))
+            {
+                cout << "Error opening file" << endl;
+                return;
+            }
+
+            // Appended in chunks, as a simulation would dump them
+            for (size_t i = 0; i < N; i += 10000)
+                writer.append(std::span(particles).subspan(i, std::min< size_t >(10000, N - i)));
+
+            writer.close();
+        });
+
+        cout << (layout == ParticleLayout::AOS ? "store, AOS            " : "store, SOA            ") << setw(10)
+             << t << " s\n";
+    }
+
+    // Reading
+
+    cout << "\n";
+
+    for (string name : {"particles_aos.dat", "particles_soa.dat"})
+    {
+        ParticleFile file;
+        Particle p{};
+
+        size_t k = N / 2 + 1;
+
+        double tOpen = timeIt([&]() {
+            if (file.open(name))
+                p = file[k];
+        });
+
+        if (!file.isOpen())
+        {
+            cout << "Error opening file" << endl;
+            return 1;
+        }
+
+        bool same = (p.x == particles[k].x) && (p.y == particles[k].y) && (p.mass == particles[k].mass);
+
+        Moments m;
+
+        double tScan = timeIt([&]() {
+            m = file.parallelReduce(
+                Moments(), [](const Particle &p) { return Moments{p.mass, p.mass * p.x, p.mass * p.y}; },
+                [](const Moments &a, const Moments &b) { return Moments{a.mass + b.mass, a.mx + b.mx, a.my + b.my}; });
+        });
+
+        cout << name << ": open + record " << k << " in " << tOpen * 1e6 << " us"
+             << (same ? "" : " (wrong record)") << "\n";
+        cout << "  parallel scan " << tScan << " s, " << double(N * sizeof(Particle)) / 1e6 / tScan
+             << " MB/s, total mass " << m.mass << ", centre (" << m.mx / m.mass << ", " << m.my / m.mass
+             << ")\n";
+
+        file.close();
+    }
+
+    for (auto name : {"particles.dat", "particles_aos.dat", "particles_soa.dat"})
+        std::remove(name);
+}
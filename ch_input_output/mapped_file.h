@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The operating system pages the
+// file in on demand, so the contents can be parsed in place without copying
+// them into a buffer first. Usage mirrors ifstream: open(), isOpen(), close().
+
+class MappedFile {
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_open = false;
+
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const std::string &filename)
+    {
+        open(filename);
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile &operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_open = std::exchange(other.m_open, false);
+#ifdef _WIN32
+            m_file = std::exchange(other.m_file, INVALID_HANDLE_VALUE);
+            m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    // Maps the file, returns false if it could not be opened or mapped
+    bool open(const std::string &filename)
+    {
+        close();
+
+#ifdef _WIN32
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if (m_file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+
+        if (!GetFileSizeEx(m_file, &size))
+        {
+            close();
+            return false;
+        }
+
+        m_size = std::size_t(size.QuadPart);
+        m_open = true;
+
+        if (m_size == 0) // Empty files can not be mapped
+            return true;
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (m_mapping != nullptr)
+            m_data = static_cast< const char * >(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            return false;
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        m_size = std::size_t(st.st_size);
+        m_open = true;
+
+        if (m_size == 0) // Empty files can not be mapped
+        {
+            ::close(fd);
+            return true;
+        }
+
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps its own reference to the file
+
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast< const char * >(data);
+            madvise(data, m_size, MADV_SEQUENTIAL);
+        }
+#endif
+
+        if (m_data == nullptr)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+            UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data != nullptr)
+            munmap(const_cast< char * >(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_open = false;
+    }
+
+    bool isOpen() const
+    {
+        return m_open;
+    }
+
+    const char *data() const
+    {
+        return m_data;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    std::string_view view() const
+    {
+        return std::string_view(m_data, m_size);
+    }
+};
@@ -0,0 +1,441 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Particle record files with a versioned header. Records are stored either
+// as an array of structs (AOS, x y mass x y mass ...) or as a struct of
+// arrays (SOA). SOA files are divided into blocks of blockSize records with
+// the x, y and mass columns of a block stored after each other, so records
+// can be appended without knowing the final count, and record k is still
+// found in constant time.
+//
+// Layout:
+//
+//   Header                         64 bytes
+//   AOS: Particle[count]
+//   SOA: blocks of double x[blockSize], y[blockSize], mass[blockSize],
+//        the last block is written in full
+//
+// ParticleWriter appends records through a buffer and writes the record
+// count into the header on close(). ParticleFile memory maps a file for
+// random access and scans.
+
+struct Particle {
+    double x;
+    double y;
+    double mass;
+};
+
+enum class ParticleLayout : std::uint32_t
+{
+    AOS = 0,
+    SOA = 1
+};
+
+struct ParticleHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    ParticleLayout layout;
+    std::uint32_t recordSize;
+    std::uint64_t blockSize;
+    std::uint64_t count;
+    std::uint64_t dataOffset;
+    std::uint8_t reserved[16];
+
+    static constexpr char fileMagic[8] = {'P', 'A', 'R', 'T', 'I', 'C', 'L', 'E'};
+    static constexpr std::uint32_t fileVersion = 1;
+    static constexpr std::uint32_t nativeByteOrder = 0x01020304;
+
+    // Checks magic, version, byte order and record size
+    bool valid() const
+    {
+        return (std::memcmp(magic, fileMagic, sizeof(fileMagic)) == 0) && (version == fileVersion) &&
+               (byteOrder == nativeByteOrder) && (recordSize == sizeof(Particle)) &&
+               ((layout == ParticleLayout::AOS) || ((layout == ParticleLayout::SOA) && (blockSize > 0))) &&
+               (dataOffset >= sizeof(ParticleHeader));
+    }
+
+    // Bytes of record data for count records
+    std::uint64_t dataSize() const
+    {
+        if (layout == ParticleLayout::AOS)
+            return count * sizeof(Particle);
+
+        return (count + blockSize - 1) / blockSize * blockSize * sizeof(Particle);
+    }
+
+    // True if the records fit in a file of fileSize bytes. Divides instead of
+    // multiplying, so a corrupt count or offset cannot overflow the check.
+    bool fits(std::uint64_t fileSize) const
+    {
+        if (dataOffset > fileSize)
+            return false;
+
+        std::uint64_t records = (fileSize - dataOffset) / sizeof(Particle);
+
+        if (layout == ParticleLayout::AOS)
+            return count <= records;
+
+        // SOA files hold whole blocks
+        return count / blockSize + (count % blockSize != 0 ? 1 : 0) <= records / blockSize;
+    }
+};
+
+static_assert(sizeof(ParticleHeader) == 64);
+static_assert(sizeof(Particle) == 3 * sizeof(double));
+
+class ParticleWriter {
+private:
+    std::fstream m_file;
+    ParticleHeader m_header{};
+    std::vector< Particle > m_aos;    // AOS: pending records
+    std::vector< double > m_block;    // SOA: current block, columns after each other
+    std::size_t m_blockFill = 0;      // SOA: records in the current block
+    std::size_t m_bufferSize = 65536; // AOS: records per write
+
+    void writeBlock()
+    {
+        m_file.write(reinterpret_cast< const char * >(m_block.data()),
+                     std::streamsize(m_block.size() * sizeof(double)));
+    }
+
+    void flushAos()
+    {
+        m_file.write(reinterpret_cast< const char * >(m_aos.data()),
+                     std::streamsize(m_aos.size() * sizeof(Particle)));
+        m_aos.clear();
+    }
+
+public:
+    ParticleWriter() = default;
+
+    ~ParticleWriter()
+    {
+        close();
+    }
+
+    // Creates filename, or with append opens an existing file with the same
+    // layout and continues after its last record. Returns false if the file
+    // can not be opened or has another layout or format.
+    bool open(const std::string &filename, ParticleLayout layout, std::size_t blockSize = 4096,
+              bool append = false)
+    {
+        close();
+
+        if (append)
+        {
+            m_file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+
+            if (!m_file.is_open())
+                return false;
+
+            m_file.read(reinterpret_cast< char * >(&m_header), sizeof(m_header));
+
+            if (!m_file || !m_header.valid() || (m_header.layout != layout))
+            {
+                m_file.close();
+                return false;
+            }
+        }
+        else
+        {
+            m_file.open(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+
+            if (!m_file.is_open())
+                return false;
+
+            m_header = ParticleHeader{};
+            std::memcpy(m_header.magic, ParticleHeader::fileMagic, sizeof(m_header.magic));
+            m_header.version = ParticleHeader::fileVersion;
+            m_header.byteOrder = ParticleHeader::nativeByteOrder;
+            m_header.layout = layout;
+            m_header.recordSize = sizeof(Particle);
+            m_header.blockSize = layout == ParticleLayout::SOA ? std::max< std::size_t >(blockSize, 1) : 0;
+            m_header.count = 0;
+            m_header.dataOffset = sizeof(ParticleHeader);
+
+            m_file.write(reinterpret_cast< const char * >(&m_header), sizeof(m_header));
+        }
+
+        if (layout == ParticleLayout::AOS)
+        {
+            m_aos.reserve(m_bufferSize);
+            m_file.seekp(std::streamoff(m_header.dataOffset + m_header.dataSize()));
+        }
+        else
+        {
+            // A partly filled last block is read back and rewritten in place
+
+            m_block.assign(3 * m_header.blockSize, 0.0);
+            m_blockFill = m_header.count % m_header.blockSize;
+
+            std::uint64_t blockStart = m_header.dataOffset + (m_header.count - m_blockFill) * sizeof(Particle);
+
+            if (m_blockFill > 0)
+            {
+                m_file.seekg(std::streamoff(blockStart));
+                m_file.read(reinterpret_cast< char * >(m_block.data()),
+                            std::streamsize(m_block.size() * sizeof(double)));
+            }
+
+            m_file.seekp(std::streamoff(blockStart));
+        }
+
+        return bool(m_file);
+    }
+
+    void append(const Particle &p)
+    {
+        append(std::span< const Particle >(&p, 1));
+    }
+
+    void append(std::span< const Particle > particles)
+    {
+        if (m_header.layout == ParticleLayout::AOS)
+        {
+            for (std::size_t i = 0; i < particles.size();)
+            {
+                std::size_t count = std::min(particles.size() - i, m_bufferSize - m_aos.size());
+                m_aos.insert(m_aos.end(), particles.begin() + i, particles.begin() + i + count);
+                i += count;
+
+                if (m_aos.size() == m_bufferSize)
+                    flushAos();
+            }
+        }
+        else
+        {
+            std::size_t n = m_header.blockSize;
+
+            for (const Particle &p : particles)
+            {
+                m_block[m_blockFill] = p.x;
+                m_block[n + m_blockFill] = p.y;
+                m_block[2 * n + m_blockFill] = p.mass;
+
+                if (++m_blockFill == n)
+                {
+                    writeBlock();
+                    m_blockFill = 0;
+                }
+            }
+        }
+
+        m_header.count += particles.size();
+    }
+
+    std::size_t size() const
+    {
+        return m_header.count;
+    }
+
+    // Writes pending records and the header. The file is complete only
+    // after close().
+    bool close()
+    {
+        if (!m_file.is_open())
+            return true;
+
+        if (m_header.layout == ParticleLayout::AOS)
+            flushAos();
+        else if (m_blockFill > 0)
+        {
+            // Zero the unused tail of the x, y and mass columns
+
+            const std::size_t n = m_header.blockSize;
+
+            for (std::size_t column = 0; column < 3; ++column)
+                std::fill(m_block.begin() + column * n + m_blockFill, m_block.begin() + (column + 1) * n, 0.0);
+
+            writeBlock();
+        }
+
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast< const char * >(&m_header), sizeof(m_header));
+
+        bool ok = bool(m_file);
+
+        m_file.close();
+        m_aos = std::vector< Particle >();
+        m_block = std::vector< double >();
+        m_blockFill = 0;
+
+        return ok;
+    }
+};
+
+class ParticleFile {
+private:
+    MappedFile m_file;
+    ParticleHeader m_header{};
+    const double *m_data = nullptr;
+
+public:
+    // Maps a particle file, returns false if it is missing, truncated or of
+    // another version or byte order. Only the header is read.
+    bool open(const std::string &filename)
+    {
+        close();
+
+        if (!m_file.open(filename) || (m_file.size() < sizeof(ParticleHeader)))
+        {
+            close();
+            return false;
+        }
+
+        std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+
+        if (!m_header.valid() || !m_header.fits(m_file.size()) || (m_header.dataOffset % sizeof(double) != 0))
+        {
+            close();
+            return false;
+        }
+
+        m_data = reinterpret_cast< const double * >(m_file.data() + m_header.dataOffset);
+
+        return true;
+    }
+
+    void close()
+    {
+        m_file.close();
+        m_header = ParticleHeader{};
+        m_data = nullptr;
+    }
+
+    bool isOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    std::size_t size() const
+    {
+        return m_header.count;
+    }
+
+    ParticleLayout layout() const
+    {
+        return m_header.layout;
+    }
+
+    std::size_t blockSize() const
+    {
+        return m_header.blockSize;
+    }
+
+    // Record k, constant time for both layouts
+    Particle operator[](std::size_t k) const
+    {
+        if (m_header.layout == ParticleLayout::AOS)
+            return Particle{m_data[3 * k], m_data[3 * k + 1], m_data[3 * k + 2]};
+
+        std::size_t n = m_header.blockSize;
+        const double *block = m_data + k / n * 3 * n;
+        std::size_t i = k % n;
+
+        return Particle{block[i], block[n + i], block[2 * n + i]};
+    }
+
+    // Calls visitor(k, particle) for records [first, last)
+    template < typename Visitor > void forEach(std::size_t first, std::size_t last, Visitor &&visitor) const
+    {
+        if (m_header.layout == ParticleLayout::AOS)
+        {
+            for (std::size_t k = first; k < last; ++k)
+                visitor(k, Particle{m_data[3 * k], m_data[3 * k + 1], m_data[3 * k + 2]});
+            return;
+        }
+
+        // Block by block, reading the three columns sequentially
+
+        std::size_t n = m_header.blockSize;
+
+        for (std::size_t k = first; k < last;)
+        {
+            const double *block = m_data + k / n * 3 * n;
+            std::size_t end = std::min(last, (k / n + 1) * n);
+
+            for (std::size_t i = k % n; k < end; ++k, ++i)
+                visitor(k, Particle{block[i], block[n + i], block[2 * n + i]});
+        }
+    }
+
+    template < typename Visitor > void forEach(Visitor &&visitor) const
+    {
+        forEach(0, size(), visitor);
+    }
+
+    // Splits the records into one contiguous range per thread, aligned to
+    // blocks for SOA files, and calls visitor(k, particle) concurrently on
+    // the ranges. The visitor must be safe to call from several threads.
+    template < typename Visitor > void parallelForEach(Visitor &&visitor, int threads = 0) const
+    {
+        if (threads <= 0)
+            threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+        std::size_t grain = m_header.layout == ParticleLayout::SOA ? m_header.blockSize : 1;
+        std::size_t units = (size() + grain - 1) / grain;
+
+        std::vector< std::jthread > workers;
+
+        for (int t = 0; t < threads; ++t)
+        {
+            std::size_t first = std::min(size(), units * t / threads * grain);
+            std::size_t last = std::min(size(), units * (t + 1) / threads * grain);
+
+            if (first < last)
+                workers.emplace_back([this, first, last, &visitor]() { forEach(first, last, visitor); });
+        }
+    }
+
+    // Reduces map(particle) over all records with combine, one partial
+    // result per thread starting from init, which must be the identity of
+    // combine. Results are combined in thread order, so for a given thread
+    // count the result is the same on every run.
+    template < typename T, typename Map, typename Combine >
+    T parallelReduce(T init, Map map, Combine combine, int threads = 0) const
+    {
+        if (threads <= 0)
+            threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+        std::size_t grain = m_header.layout == ParticleLayout::SOA ? m_header.blockSize : 1;
+        std::size_t units = (size() + grain - 1) / grain;
+
+        std::vector< T > partial(threads, init);
+
+        {
+            std::vector< std::jthread > workers;
+
+            for (int t = 0; t < threads; ++t)
+            {
+                std::size_t first = std::min(size(), units * t / threads * grain);
+                std::size_t last = std::min(size(), units * (t + 1) / threads * grain);
+
+                workers.emplace_back([this, first, last, t, &partial, &map, &combine]() {
+                    T result = partial[t];
+                    forEach(first, last,
+                            [&](std::size_t, const Particle &p) { result = combine(result, map(p)); });
+                    partial[t] = result;
+                });
+            }
+        }
+
+        T result = init;
+
+        for (const T &value : partial)
+            result = combine(result, value);
+
+        return result;
+    }
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "csv_reader.h"
+#include "mapped_file.h"
+
+// Columnar binary cache for (timestamp, value) series. The file is written
+// once from a parsed CSV file and memory mapped on later runs, so opening
+// it costs the same regardless of the number of rows.
+//
+// Layout, all offsets aligned to 64 bytes:
+//
+//   Header                                  64 bytes
+//   BlockInfo[blockCount]                   min/max of every block
+//   int64_t time[rows]                      seconds since 1970-01-01
+//   double value[rows]
+//
+// The rows are divided into blocks of blockSize rows. The per-block min/max
+// let range queries skip blocks that can not contain matching rows. The
+// file is stored in native byte order, which is checked on open.
+
+class TimeSeriesCache {
+public:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t rows;
+        std::uint64_t blockSize;
+        std::uint64_t blockCount;
+        std::uint64_t blockOffset;
+        std::uint64_t timeOffset;
+        std::uint64_t valueOffset;
+    };
+
+    struct BlockInfo {
+        std::int64_t minTime;
+        std::int64_t maxTime;
+        double minValue;
+        double maxValue;
+    };
+
+    static_assert(sizeof(Header) == 64);
+    static_assert(sizeof(BlockInfo) == 32);
+
+private:
+    static constexpr char fileMagic[8] = {'T', 'S', 'C', 'A', 'C', 'H', 'E', '\0'};
+    static constexpr std::uint32_t fileVersion = 1;
+    static constexpr std::uint32_t nativeByteOrder = 0x01020304;
+    static constexpr std::uint64_t alignment = 64;
+
+    MappedFile m_file;
+    const Header *m_header = nullptr;
+    std::span< const BlockInfo > m_blocks;
+    std::span< const std::int64_t > m_time;
+    std::span< const double > m_value;
+
+    static std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Calls visitor(time, value) for rows [first, last) accepted by match
+    template < typename Match, typename Visitor >
+    std::size_t scanBlock(std::size_t block, Match &match, Visitor &visitor) const
+    {
+        std::size_t first = block * m_header->blockSize;
+        std::size_t last = std::min(first + m_header->blockSize, m_time.size());
+        std::size_t count = 0;
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            if (match(m_time[i], m_value[i]))
+            {
+                visitor(m_time[i], m_value[i]);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+public:
+    // Writes series to filename, returns false if the file could not be written
+    static bool write(const std::string &filename, const TimeSeries &series, std::size_t blockSize = 4096)
+    {
+        Header header{};
+        std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+        header.version = fileVersion;
+        header.byteOrder = nativeByteOrder;
+        header.rows = series.size();
+        header.blockSize = std::max< std::size_t >(blockSize, 1);
+        header.blockCount = (header.rows + header.blockSize - 1) / header.blockSize;
+        header.blockOffset = align(sizeof(Header));
+        header.timeOffset = align(header.blockOffset + header.blockCount * sizeof(BlockInfo));
+        header.valueOffset = align(header.timeOffset + header.rows * sizeof(std::int64_t));
+
+        std::vector< BlockInfo > blocks(header.blockCount);
+
+        for (std::size_t b = 0; b < blocks.size(); ++b)
+        {
+            std::size_t first = b * header.blockSize;
+            std::size_t last = std::min< std::size_t >(first + header.blockSize, header.rows);
+
+            auto [minTime, maxTime] =
+                std::minmax_element(series.time.begin() + first, series.time.begin() + last);
+            auto [minValue, maxValue] =
+                std::minmax_element(series.value.begin() + first, series.value.begin() + last);
+
+            blocks[b] = BlockInfo{*minTime, *maxTime, *minValue, *maxValue};
+        }
+
+        std::ofstream outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!outfile.is_open())
+            return false;
+
+        auto pad = [&outfile](std::uint64_t offset) {
+            static const char zeros[alignment] = {};
+            outfile.write(zeros, std::streamsize(offset - std::uint64_t(outfile.tellp())));
+        };
+
+        outfile.write(reinterpret_cast< const char * >(&header), sizeof(header));
+        pad(header.blockOffset);
+        outfile.write(reinterpret_cast< const char * >(blocks.data()),
+                      std::streamsize(blocks.size() * sizeof(BlockInfo)));
+        pad(header.timeOffset);
+        outfile.write(reinterpret_cast< const char * >(series.time.data()),
+                      std::streamsize(series.time.size() * sizeof(std::int64_t)));
+        pad(header.valueOffset);
+        outfile.write(reinterpret_cast< const char * >(series.value.data()),
+                      std::streamsize(series.value.size() * sizeof(double)));
+
+        return outfile.good();
+    }
+
+    // Maps a cache file, returns false if it is missing, truncated or was
+    // written with another version or byte order
+    bool open(const std::string &filename)
+    {
+        close();
+
+        if (!m_file.open(filename))
+            return false;
+
+        const Header *header = reinterpret_cast< const Header * >(m_file.data());
+
+        // An array of count elements starts at offset, is 8 byte aligned and
+        // ends before end. Divides instead of multiplying, so corrupt values
+        // cannot overflow the check.
+        auto fits = [](std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize, std::uint64_t end) {
+            return (offset % sizeof(std::int64_t) == 0) && (offset <= end) && (count <= (end - offset) / elementSize);
+        };
+
+        bool valid = (m_file.size() >= sizeof(Header)) &&
+                     (std::memcmp(header->magic, fileMagic, sizeof(fileMagic)) == 0) &&
+                     (header->version == fileVersion) && (header->byteOrder == nativeByteOrder) &&
+                     (header->blockSize > 0) &&
+                     (header->blockCount ==
+                      header->rows / header->blockSize + (header->rows % header->blockSize != 0 ? 1 : 0)) &&
+                     fits(header->blockOffset, header->blockCount, sizeof(BlockInfo), header->timeOffset) &&
+                     fits(header->timeOffset, header->rows, sizeof(std::int64_t), header->valueOffset) &&
+                     fits(header->valueOffset, header->rows, sizeof(double), m_file.size());
+
+        if (!valid)
+        {
+            close();
+            return false;
+        }
+
+        m_header = header;
+        m_blocks = std::span(reinterpret_cast< const BlockInfo * >(m_file.data() + header->blockOffset),
+                             header->blockCount);
+        m_time = std::span(reinterpret_cast< const std::int64_t * >(m_file.data() + header->timeOffset),
+                           header->rows);
+        m_value =
+            std::span(reinterpret_cast< const double * >(m_file.data() + header->valueOffset), header->rows);
+
+        return true;
+    }
+
+    void close()
+    {
+        m_file.close();
+        m_header = nullptr;
+        m_blocks = {};
+        m_time = {};
+        m_value = {};
+    }
+
+    bool isOpen() const
+    {
+        return m_header != nullptr;
+    }
+
+    std::size_t size() const
+    {
+        return m_time.size();
+    }
+
+    std::size_t blockSize() const
+    {
+        return m_header != nullptr ? m_header->blockSize : 0;
+    }
+
+    // Columns, valid while the cache is open
+
+    std::span< const std::int64_t > time() const
+    {
+        return m_time;
+    }
+
+    std::span< const double > value() const
+    {
+        return m_value;
+    }
+
+    std::span< const BlockInfo > blocks() const
+    {
+        return m_blocks;
+    }
+
+    // Calls visitor(time, value) for all rows with first <= time < last and
+    // returns their number. Blocks outside the interval are skipped, and the
+    // number of blocks actually read is returned in blocksRead.
+    template < typename Visitor >
+    std::size_t forEachInRange(std::int64_t first, std::int64_t last, Visitor &&visitor,
+                               std::size_t *blocksRead = nullptr) const
+    {
+        auto match = [first, last](std::int64_t t, double) { return (t >= first) && (t < last); };
+        std::size_t count = 0;
+        std::size_t read = 0;
+
+        for (std::size_t b = 0; b < m_blocks.size(); ++b)
+        {
+            if ((m_blocks[b].maxTime < first) || (m_blocks[b].minTime >= last))
+                continue;
+
+            count += scanBlock(b, match, visitor);
+            ++read;
+        }
+
+        if (blocksRead != nullptr)
+            *blocksRead = read;
+
+        return count;
+    }
+
+    // Calls visitor(time, value) for all rows with value >= threshold,
+    // skipping blocks whose maximum is below it
+    template < typename Visitor >
+    std::size_t forEachAbove(double threshold, Visitor &&visitor, std::size_t *blocksRead = nullptr) const
+    {
+        auto match = [threshold](std::int64_t, double v) { return v >= threshold; };
+        std::size_t count = 0;
+        std::size_t read = 0;
+
+        for (std::size_t b = 0; b < m_blocks.size(); ++b)
+        {
+            if (m_blocks[b].maxValue < threshold)
+                continue;
+
+            count += scanBlock(b, match, visitor);
+            ++read;
+        }
+
+        if (blocksRead != nullptr)
+            *blocksRead = read;
+
+        return count;
+    }
+};
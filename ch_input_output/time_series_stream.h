@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// Single-pass aggregation of (time, value) streams, for example straight
+// from CsvReader::forEach(). Time is in seconds since 1970-01-01 00:00:00.
+//
+// ReorderBuffer restores time order and resolves duplicate timestamps,
+// holding at most the samples that arrive within its lateness bound.
+// Resampler, RollingWindow and GroupBy then consume the ordered stream,
+// each with constant memory or memory proportional to its window. Stages
+// are connected through callables:
+//
+//   Resampler daily(Period::DAY, [](int64_t start, const Summary &s) { ... });
+//   ReorderBuffer reorder(366 * 86400, [&](int64_t t, double v) { daily.add(t, v); });
+//   reader.forEach([&](int64_t t, double v) { reorder.add(t, v); });
+//   reorder.finish();
+//   daily.finish();
+
+// Count, sum, minimum and maximum of a set of values
+
+struct Summary {
+    std::size_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits< double >::infinity();
+    double max = -std::numeric_limits< double >::infinity();
+
+    void add(double value)
+    {
+        ++count;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    double mean() const
+    {
+        return count > 0 ? sum / double(count) : 0.0;
+    }
+};
+
+// How samples with the same timestamp are combined
+
+enum class Duplicates
+{
+    KEEP_FIRST,
+    KEEP_LAST,
+    MEAN
+};
+
+// Passes samples on in time order. A sample is held until a sample more than
+// lateness seconds newer has been seen, so input that is ordered except for
+// displacements up to lateness comes out fully ordered. Samples that arrive
+// after newer samples have already been passed on are dropped and counted.
+// Samples with equal timestamps are combined according to Duplicates.
+
+template < typename Output > class ReorderBuffer {
+private:
+    struct Sample {
+        std::int64_t time;
+        std::uint64_t sequence; // Arrival order, to resolve duplicates
+        double value;
+
+        bool operator>(const Sample &other) const
+        {
+            return (time > other.time) || ((time == other.time) && (sequence > other.sequence));
+        }
+    };
+
+    std::priority_queue< Sample, std::vector< Sample >, std::greater< Sample > > m_pending;
+    Output m_output;
+    std::int64_t m_lateness;
+    Duplicates m_duplicates;
+
+    std::uint64_t m_sequence = 0;
+    std::int64_t m_newest = std::numeric_limits< std::int64_t >::min();
+
+    // Sample waiting for possible duplicates before being passed on
+    bool m_hasCurrent = false;
+    std::int64_t m_currentTime = 0;
+    double m_currentValue = 0.0;
+    std::size_t m_currentCount = 0;
+
+    std::size_t m_dropped = 0;
+    std::size_t m_duplicateCount = 0;
+    std::size_t m_maxPending = 0;
+
+    void emit(const Sample &sample)
+    {
+        if (m_hasCurrent && (sample.time < m_currentTime))
+        {
+            ++m_dropped; // Older than what has already been passed on
+            return;
+        }
+
+        if (m_hasCurrent && (sample.time == m_currentTime))
+        {
+            ++m_duplicateCount;
+
+            if (m_duplicates == Duplicates::KEEP_LAST)
+                m_currentValue = sample.value;
+            else if (m_duplicates == Duplicates::MEAN)
+            {
+                m_currentValue += sample.value;
+                ++m_currentCount;
+            }
+            return;
+        }
+
+        flushCurrent();
+
+        m_hasCurrent = true;
+        m_currentTime = sample.time;
+        m_currentValue = sample.value;
+        m_currentCount = 1;
+    }
+
+    void flushCurrent()
+    {
+        if (m_hasCurrent && (m_currentCount > 0))
+            m_output(m_currentTime, m_currentValue / double(m_currentCount));
+
+        m_currentCount = 0;
+    }
+
+public:
+    ReorderBuffer(std::int64_t lateness, Output output, Duplicates duplicates = Duplicates::KEEP_FIRST)
+        : m_output(output), m_lateness(lateness), m_duplicates(duplicates)
+    {
+    }
+
+    void add(std::int64_t time, double value)
+    {
+        m_pending.push(Sample{time, m_sequence++, value});
+        m_newest = std::max(m_newest, time);
+        m_maxPending = std::max(m_maxPending, m_pending.size());
+
+        while (!m_pending.empty() && (m_pending.top().time < m_newest - m_lateness))
+        {
+            emit(m_pending.top());
+            m_pending.pop();
+        }
+    }
+
+    // Passes on all remaining samples, call at end of input
+    void finish()
+    {
+        while (!m_pending.empty())
+        {
+            emit(m_pending.top());
+            m_pending.pop();
+        }
+
+        flushCurrent();
+    }
+
+    std::size_t dropped() const
+    {
+        return m_dropped;
+    }
+
+    std::size_t duplicates() const
+    {
+        return m_duplicateCount;
+    }
+
+    // Largest number of samples held at any time
+    std::size_t maxPending() const
+    {
+        return m_maxPending;
+    }
+};
+
+// Calendar periods, weeks start on Monday
+
+enum class Period
+{
+    HOUR,
+    DAY,
+    WEEK,
+    MONTH,
+    YEAR
+};
+
+// Start of the period containing time
+inline std::int64_t periodStart(std::int64_t time, Period period)
+{
+    using namespace std::chrono;
+
+    sys_seconds t{seconds(time)};
+    sys_days day = floor< days >(t);
+
+    switch (period)
+    {
+    case Period::HOUR:
+        return sys_seconds(floor< hours >(t)).time_since_epoch().count();
+    case Period::DAY:
+        return sys_seconds(day).time_since_epoch().count();
+    case Period::WEEK:
+        return sys_seconds(day - (weekday(day) - Monday)).time_since_epoch().count();
+    case Period::MONTH: {
+        year_month_day date(day);
+        return sys_seconds(sys_days(date.year() / date.month() / 1)).time_since_epoch().count();
+    }
+    case Period::YEAR: {
+        year_month_day date(day);
+        return sys_seconds(sys_days(date.year() / January / 1)).time_since_epoch().count();
+    }
+    }
+
+    return time;
+}
+
+// Summarises an ordered stream per calendar period and calls
+// output(periodStart, summary) whenever a period is complete. Only the
+// current period is kept in memory.
+
+template < typename Output > class Resampler {
+private:
+    Period m_period;
+    Output m_output;
+    bool m_active = false;
+    std::int64_t m_start = 0;
+    Summary m_summary;
+
+public:
+    Resampler(Period period, Output output) : m_period(period), m_output(output)
+    {
+    }
+
+    void add(std::int64_t time, double value)
+    {
+        std::int64_t start = periodStart(time, m_period);
+
+        if (m_active && (start != m_start))
+        {
+            m_output(m_start, m_summary);
+            m_summary = Summary();
+        }
+
+        m_active = true;
+        m_start = start;
+        m_summary.add(value);
+    }
+
+    // Reports the last period, call at end of input
+    void finish()
+    {
+        if (m_active)
+            m_output(m_start, m_summary);
+
+        m_active = false;
+        m_summary = Summary();
+    }
+};
+
+// Mean, minimum and maximum over the trailing window (time - window, time]
+// of an ordered stream. output(time, summary) is called for every sample.
+// The samples in the window are kept in a deque, and the minimum and
+// maximum are tracked with monotonic deques, so every sample costs
+// amortised constant time and memory is proportional to the window.
+
+template < typename Output > class RollingWindow {
+private:
+    struct Sample {
+        std::int64_t time;
+        double value;
+    };
+
+    std::int64_t m_window;
+    Output m_output;
+
+    std::deque< Sample > m_samples;
+    std::deque< Sample > m_min; // Increasing values
+    std::deque< Sample > m_max; // Decreasing values
+    double m_sum = 0.0;
+
+public:
+    RollingWindow(std::int64_t window, Output output) : m_window(window), m_output(output)
+    {
+    }
+
+    void add(std::int64_t time, double value)
+    {
+        std::int64_t first = time - m_window;
+
+        while (!m_samples.empty() && (m_samples.front().time <= first))
+        {
+            m_sum -= m_samples.front().value;
+            m_samples.pop_front();
+        }
+
+        while (!m_min.empty() && (m_min.front().time <= first))
+            m_min.pop_front();
+        while (!m_max.empty() && (m_max.front().time <= first))
+            m_max.pop_front();
+
+        while (!m_min.empty() && (m_min.back().value >= value))
+            m_min.pop_back();
+        while (!m_max.empty() && (m_max.back().value <= value))
+            m_max.pop_back();
+
+        m_samples.push_back(Sample{time, value});
+        m_min.push_back(Sample{time, value});
+        m_max.push_back(Sample{time, value});
+
+        if (m_samples.size() == 1)
+            m_sum = value; // Restart the running sum to avoid drift
+        else
+            m_sum += value;
+
+        Summary summary;
+        summary.count = m_samples.size();
+        summary.sum = m_sum;
+        summary.min = m_min.front().value;
+        summary.max = m_max.front().value;
+
+        m_output(time, summary);
+    }
+};
+
+// Summaries per hour of day (0-23) or day of week (0 = Monday). The
+// accumulators are independent of arrival order, so GroupBy can also be fed
+// the unordered stream.
+
+enum class GroupKey
+{
+    HOUR_OF_DAY,
+    DAY_OF_WEEK
+};
+
+class GroupBy {
+private:
+    GroupKey m_key;
+    std::array< Summary, 24 > m_groups;
+
+public:
+    GroupBy(GroupKey key) : m_key(key)
+    {
+    }
+
+    static std::size_t group(std::int64_t time, GroupKey key)
+    {
+        using namespace std::chrono;
+
+        sys_seconds t{seconds(time)};
+        sys_days day = floor< days >(t);
+
+        if (key == GroupKey::HOUR_OF_DAY)
+            return std::size_t(duration_cast< hours >(t - day).count());
+
+        return (weekday(day) - Monday).count();
+    }
+
+    void add(std::int64_t time, double value)
+    {
+        m_groups[group(time, m_key)].add(value);
+    }
+
+    std::size_t size() const
+    {
+        return m_key == GroupKey::HOUR_OF_DAY ? 24 : 7;
+    }
+
+    const Summary &operator[](std::size_t index) const
+    {
+        return m_groups[index];
+    }
+};
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Reader for VIT raster files such as data/colorado_elev.vit. The file is
+// memory mapped and pixels are converted on access, so any window of the
+// image can be read while only the pages it covers are loaded.
+//
+// Layout, all integers big-endian:
+//
+//   0    file header, 124 bytes, "VITec" at offset 32
+//   124  image header:
+//          +0   uint32 image header size (144)
+//          +4   uint32 image record size (header + pixels)
+//          +24  uint32 pixel type code
+//          +36  uint32 width
+//          +40  uint32 height
+//   124 + image header size: pixels, row by row
+//
+// The size of a pixel follows from the record size. Pixels of one byte are
+// unsigned. Two-byte pixels are signed when the type code is 5 and unsigned
+// otherwise, and four-byte pixels are IEEE floats.
+
+class VitRaster {
+public:
+    enum class PixelType
+    {
+        UINT8,
+        INT16,
+        UINT16,
+        FLOAT32
+    };
+
+    // A window of the image converted to float, row-major with cols values
+    // per row
+    struct Tile {
+        std::size_t row;
+        std::size_t col;
+        std::size_t rows;
+        std::size_t cols;
+        std::span< const float > data;
+
+        float operator()(std::size_t i, std::size_t j) const
+        {
+            return data[i * cols + j];
+        }
+    };
+
+private:
+    static constexpr std::size_t fileHeaderSize = 124;
+
+    MappedFile m_file;
+    const unsigned char *m_pixels = nullptr;
+    std::size_t m_width = 0;
+    std::size_t m_height = 0;
+    std::size_t m_bytesPerPixel = 0;
+    std::size_t m_dataOffset = 0;
+    std::uint32_t m_typeCode = 0;
+    PixelType m_pixelType = PixelType::UINT8;
+
+    static std::uint32_t readBigEndian32(const unsigned char *p)
+    {
+        return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) |
+               std::uint32_t(p[3]);
+    }
+
+    // Converts count pixels starting at p to float
+    void convert(const unsigned char *p, std::size_t count, float *out) const
+    {
+        switch (m_pixelType)
+        {
+        case PixelType::UINT8:
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = float(p[i]);
+            break;
+        case PixelType::INT16:
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = float(std::int16_t((p[2 * i] << 8) | p[2 * i + 1]));
+            break;
+        case PixelType::UINT16:
+            for (std::size_t i = 0; i < count; ++i)
+                out[i] = float(std::uint16_t((p[2 * i] << 8) | p[2 * i + 1]));
+            break;
+        case PixelType::FLOAT32:
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                std::uint32_t bits = readBigEndian32(p + 4 * i);
+                std::memcpy(&out[i], &bits, sizeof(float));
+            }
+            break;
+        }
+    }
+
+public:
+    // Maps the file and parses the header, returns false if the file can not
+    // be opened or is not a valid VIT raster
+    bool open(const std::string &filename)
+    {
+        close();
+
+        if (!m_file.open(filename))
+            return false;
+
+        const unsigned char *data = reinterpret_cast< const unsigned char * >(m_file.data());
+        std::size_t size = m_file.size();
+
+        if ((size < fileHeaderSize + 44) || (std::memcmp(data + 32, "VITec", 5) != 0))
+        {
+            close();
+            return false;
+        }
+
+        const unsigned char *image = data + fileHeaderSize;
+
+        std::size_t headerSize = readBigEndian32(image);
+        std::size_t recordSize = readBigEndian32(image + 4);
+        std::size_t width = readBigEndian32(image + 36);
+        std::size_t height = readBigEndian32(image + 40);
+
+        std::size_t pixelCount = width * height;
+        std::size_t dataOffset = fileHeaderSize + headerSize;
+
+        if ((width > size) || (height > size) || (pixelCount == 0) || (recordSize <= headerSize) ||
+            ((recordSize - headerSize) % pixelCount != 0) || (fileHeaderSize + recordSize > size))
+        {
+            close();
+            return false;
+        }
+
+        m_typeCode = readBigEndian32(image + 24);
+        m_bytesPerPixel = (recordSize - headerSize) / pixelCount;
+
+        switch (m_bytesPerPixel)
+        {
+        case 1:
+            m_pixelType = PixelType::UINT8;
+            break;
+        case 2:
+            m_pixelType = m_typeCode == 5 ? PixelType::INT16 : PixelType::UINT16;
+            break;
+        case 4:
+            m_pixelType = PixelType::FLOAT32;
+            break;
+        default:
+            close();
+            return false;
+        }
+
+        m_width = width;
+        m_height = height;
+        m_dataOffset = dataOffset;
+        m_pixels = data + dataOffset;
+
+        return true;
+    }
+
+    void close()
+    {
+        m_file.close();
+        m_pixels = nullptr;
+        m_width = 0;
+        m_height = 0;
+        m_bytesPerPixel = 0;
+        m_dataOffset = 0;
+    }
+
+    bool isOpen() const
+    {
+        return m_pixels != nullptr;
+    }
+
+    std::size_t width() const
+    {
+        return m_width;
+    }
+
+    std::size_t height() const
+    {
+        return m_height;
+    }
+
+    PixelType pixelType() const
+    {
+        return m_pixelType;
+    }
+
+    std::uint32_t typeCode() const
+    {
+        return m_typeCode;
+    }
+
+    std::size_t bytesPerPixel() const
+    {
+        return m_bytesPerPixel;
+    }
+
+    // Offset of the first pixel in the file
+    std::size_t dataOffset() const
+    {
+        return m_dataOffset;
+    }
+
+    float pixel(std::size_t row, std::size_t col) const
+    {
+        float value;
+        convert(m_pixels + (row * m_width + col) * m_bytesPerPixel, 1, &value);
+        return value;
+    }
+
+    // Raw bytes of a row, in file byte order
+    std::span< const unsigned char > rawRow(std::size_t row) const
+    {
+        return std::span(m_pixels + row * m_width * m_bytesPerPixel, m_width * m_bytesPerPixel);
+    }
+
+    // Reads the window of rows x cols pixels at (row, col), clipped to the
+    // image, into out and returns it as a tile. Only the rows of the window
+    // are touched in the mapping.
+    Tile readWindow(std::size_t row, std::size_t col, std::size_t rows, std::size_t cols,
+                    std::vector< float > &out) const
+    {
+        row = std::min(row, m_height);
+        col = std::min(col, m_width);
+        rows = std::min(rows, m_height - row);
+        cols = std::min(cols, m_width - col);
+
+        out.resize(rows * cols);
+
+        for (std::size_t i = 0; i < rows; ++i)
+            convert(m_pixels + ((row + i) * m_width + col) * m_bytesPerPixel, cols, out.data() + i * cols);
+
+        return Tile{row, col, rows, cols, std::span< const float >(out)};
+    }
+
+    // Calls visitor(tile) for every tile of tileRows x tileCols pixels, row
+    // of tiles by row of tiles. One tile buffer is reused, so memory use is
+    // bounded by the tile size whatever the size of the image.
+    template < typename Visitor >
+    void forEachTile(std::size_t tileRows, std::size_t tileCols, Visitor &&visitor) const
+    {
+        std::vector< float > buffer;
+        buffer.reserve(tileRows * tileCols);
+
+        for (std::size_t row = 0; row < m_height; row += tileRows)
+            for (std::size_t col = 0; col < m_width; col += tileCols)
+                visitor(readWindow(row, col, tileRows, tileCols, buffer));
+    }
+
+    // Writes the image as comma separated text, one image row per line.
+    // Rows are formatted into a reusable buffer, one-byte pixels through a
+    // lookup table and other types with std::to_chars, and the buffer is
+    // written in blocks of about blockSize bytes.
+    bool saveCsv(const std::string &filename, std::size_t blockSize = 1 << 20) const
+    {
+        std::ofstream outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!outfile.is_open())
+            return false;
+
+        // Text of 0-255 followed by a delimiter, padded to 4 bytes
+        struct Text {
+            char chars[4];
+            std::size_t length;
+        };
+
+        static const std::array< Text, 256 > table = []() {
+            std::array< Text, 256 > table{};
+            for (int v = 0; v < 256; ++v)
+            {
+                char *end = std::to_chars(table[v].chars, table[v].chars + 4, v).ptr;
+                *end++ = ',';
+                table[v].length = std::size_t(end - table[v].chars);
+            }
+            return table;
+        }();
+
+        // Longest float text from to_chars is 15 characters, plus delimiter
+        const std::size_t maxRowSize = m_width * 16 + 1;
+
+        std::vector< char > buffer(std::max(blockSize, maxRowSize) + maxRowSize);
+        std::vector< float > values(m_width);
+        char *pos = buffer.data();
+
+        for (std::size_t row = 0; row < m_height; ++row)
+        {
+            if (m_pixelType == PixelType::UINT8)
+            {
+                const unsigned char *pixels = m_pixels + row * m_width;
+
+                for (std::size_t col = 0; col < m_width; ++col)
+                {
+                    const Text &text = table[pixels[col]];
+                    std::memcpy(pos, text.chars, 4);
+                    pos += text.length;
+                }
+            }
+            else
+            {
+                convert(m_pixels + row * m_width * m_bytesPerPixel, m_width, values.data());
+
+                for (std::size_t col = 0; col < m_width; ++col)
+                {
+                    pos = std::to_chars(pos, pos + 16, values[col]).ptr;
+                    *pos++ = ',';
+                }
+            }
+
+            pos[-1] = '\n'; // Replaces the last delimiter
+
+            if (std::size_t(pos - buffer.data()) >= blockSize)
+            {
+                outfile.write(buffer.data(), pos - buffer.data());
+                pos = buffer.data();
+            }
+        }
+
+        outfile.write(buffer.data(), pos - buffer.data());
+
+        return outfile.good();
+    }
+
+    // Writes the image as a NumPy .npy file with shape (height, width), so
+    // numpy.load() reads it without parsing. The pixels are stored in file
+    // byte order with a matching dtype and copied straight from the mapping.
+    bool saveNpy(const std::string &filename, std::size_t blockSize = 1 << 20) const
+    {
+        std::ofstream outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!outfile.is_open())
+            return false;
+
+        const char *dtypes[] = {"|u1", ">i2", ">u2", ">f4"};
+
+        std::string header = "{'descr': '" + std::string(dtypes[int(m_pixelType)]) +
+                             "', 'fortran_order': False, 'shape': (" + std::to_string(m_height) + ", " +
+                             std::to_string(m_width) + "), }";
+
+        // Magic, version 1.0 and header length, header padded to 64 bytes
+        std::size_t total = (10 + header.size() + 1 + 63) / 64 * 64;
+        header.append(total - 10 - header.size() - 1, ' ');
+        header += '\n';
+
+        std::uint16_t headerLength = std::uint16_t(header.size());
+        char preamble[10] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0, char(headerLength & 0xff),
+                             char(headerLength >> 8)};
+
+        outfile.write(preamble, sizeof(preamble));
+        outfile.write(header.data(), std::streamsize(header.size()));
+
+        std::size_t size = m_width * m_height * m_bytesPerPixel;
+
+        for (std::size_t offset = 0; offset < size; offset += blockSize)
+            outfile.write(reinterpret_cast< const char * >(m_pixels + offset),
+                          std::streamsize(std::min(blockSize, size - offset)));
+
+        return outfile.good();
+    }
+
+    // Writes a uint8 raster with the header fields that open() reads
+    static bool write(const std::string &filename, std::size_t width, std::size_t height,
+                      std::span< const std::uint8_t > pixels)
+    {
+        if (pixels.size() != width * height)
+            return false;
+
+        std::ofstream outfile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!outfile.is_open())
+            return false;
+
+        const std::size_t imageHeaderSize = 144;
+
+        unsigned char header[fileHeaderSize + imageHeaderSize] = {};
+
+        auto put = [&header](std::size_t offset, std::uint32_t value) {
+            header[offset] = (unsigned char)(value >> 24);
+            header[offset + 1] = (unsigned char)(value >> 16);
+            header[offset + 2] = (unsigned char)(value >> 8);
+            header[offset + 3] = (unsigned char)(value);
+        };
+
+        std::memcpy(header + 32, "VITec", 5);
+        put(fileHeaderSize, imageHeaderSize);
+        put(fileHeaderSize + 4, std::uint32_t(imageHeaderSize + pixels.size()));
+        put(fileHeaderSize + 24, 7);
+        put(fileHeaderSize + 36, std::uint32_t(width));
+        put(fileHeaderSize + 40, std::uint32_t(height));
+
+        outfile.write(reinterpret_cast< const char * >(header), sizeof(header));
+        outfile.write(reinterpret_cast< const char * >(pixels.data()), std::streamsize(pixels.size()));
+
+        return outfile.good();
+    }
+};
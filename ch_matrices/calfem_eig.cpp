@@ -1,7 +1,10 @@
 #include "calfem_eig.h"
 
+#include <algorithm>
 #include <cmath>
 #include <set>
+#include <thread>
+#include <vector>
 
 using namespace Eigen;
 using namespace std;
@@ -77,6 +80,35 @@ Matrix4d calfem::bar2e(const Vector2d &ex, const Vector2d &ey, const Vector2d &e
     return Ke;
 }
 
+void calfem::bar2e(const MatrixXd &ex, const MatrixXd &ey, const MatrixXd &ep, MatrixXd &Ke)
+{
+    Index n = ex.rows();
+
+    ArrayXd dx = ex.col(1).array()-ex.col(0).array();
+    ArrayXd dy = ey.col(1).array()-ey.col(0).array();
+    ArrayXd L2 = dx.square()+dy.square();
+
+    // C*nxx^2, C*nxx*nyx and C*nyx^2 with C = E*A/L
+
+    ArrayXd C = ep.col(0).array()*ep.col(1).array()/(L2*L2.sqrt());
+    ArrayXd kxx = C*dx.square();
+    ArrayXd kxy = C*dx*dy;
+    ArrayXd kyy = C*dy.square();
+
+    Ke.resize(n, 16);
+
+    for (int c=0; c<4; c++)
+        for (int r=0; r<4; r++)
+        {
+            const ArrayXd& k = (r%2==0) ? ((c%2==0) ? kxx : kxy) : ((c%2==0) ? kxy : kyy);
+
+            if ((r<2)==(c<2))
+                Ke.col(r+4*c) = k.matrix();
+            else
+                Ke.col(r+4*c) = -k.matrix();
+        }
+}
+
 double calfem::bar2s(const Vector2d &ex, const Vector2d &ey, const Vector2d &ep, const Vector4d &ed)
 {
     double E = ep(0);
@@ -109,6 +141,125 @@ void calfem::assem(const MatrixXi &topo, MatrixXd &K, const MatrixXd &Ke)
             K(topo(row), topo(col)) += Ke(row,col);
 }
 
+vector<vector<int>> calfem::colourElements(const MatrixXi &edof)
+{
+    // Greedy colouring, an element gets the lowest colour not already used
+    // by an element sharing one of its dofs.
+
+    int nDofs = edof.size()>0 ? edof.maxCoeff()+1 : 0;
+
+    vector<vector<int>> dofColours(nDofs);
+    vector<vector<int>> colours;
+    vector<char> used;
+
+    for (int i=0; i<edof.rows(); i++)
+    {
+        used.assign(colours.size()+1, 0);
+
+        for (int j=0; j<edof.cols(); j++)
+            for (auto c : dofColours[edof(i,j)])
+                used[c] = 1;
+
+        int colour = int(std::find(used.begin(), used.end(), 0)-used.begin());
+
+        if (colour==int(colours.size()))
+            colours.emplace_back();
+
+        colours[colour].push_back(i);
+
+        for (int j=0; j<edof.cols(); j++)
+            dofColours[edof(i,j)].push_back(colour);
+    }
+
+    return colours;
+}
+
+void calfem::assem(const MatrixXi &edof, MatrixXd &K, const MatrixXd &Ke, const vector<vector<int>> &colours, int nThreads)
+{
+    nThreads = std::max(1, nThreads);
+
+    Index nd = edof.cols();
+
+    auto scatter = [&](const vector<int>& elements, size_t start, size_t end)
+    {
+        for (size_t e=start; e<end; e++)
+        {
+            int i = elements[e];
+            for (Index col=0; col<nd; col++)
+                for (Index row=0; row<nd; row++)
+                    K(edof(i,row), edof(i,col)) += Ke(i, row+nd*col);
+        }
+    };
+
+    for (auto& elements : colours)
+    {
+        size_t chunkSize = elements.size()/nThreads;
+
+        std::vector<std::jthread> threads;
+        threads.reserve(nThreads);
+
+        for (int t=0; t<nThreads; t++)
+        {
+            size_t start = t*chunkSize;
+            size_t end = (t==nThreads-1) ? elements.size() : (t+1)*chunkSize;
+            threads.emplace_back(scatter, std::cref(elements), start, end);
+        }
+    }
+}
+
+void calfem::assem(const MatrixXi &edof, MatrixXd &K, const MatrixXd &Ke, int nThreads)
+{
+    calfem::assem(edof, K, Ke, calfem::colourElements(edof), nThreads);
+}
+
+void calfem::assem(const MatrixXi &edof, SparseMatrix<double> &K, const MatrixXd &Ke, int nThreads)
+{
+    nThreads = std::max(1, nThreads);
+
+    Index nd = edof.cols();
+    Index nElements = edof.rows();
+
+    vector<vector<Triplet<double>>> buffers(nThreads);
+
+    auto collect = [&](vector<Triplet<double>>& triplets, Index start, Index end)
+    {
+        triplets.reserve((end-start)*nd*nd);
+
+        for (Index i=start; i<end; i++)
+            for (Index col=0; col<nd; col++)
+                for (Index row=0; row<nd; row++)
+                    triplets.emplace_back(edof(i,row), edof(i,col), Ke(i, row+nd*col));
+    };
+
+    {
+        Index chunkSize = nElements/nThreads;
+
+        std::vector<std::jthread> threads;
+        threads.reserve(nThreads);
+
+        for (int t=0; t<nThreads; t++)
+        {
+            Index start = t*chunkSize;
+            Index end = (t==nThreads-1) ? nElements : (t+1)*chunkSize;
+            threads.emplace_back(collect, std::ref(buffers[t]), start, end);
+        }
+    }
+
+    vector<Triplet<double>> triplets;
+    triplets.reserve(nElements*nd*nd+K.nonZeros());
+
+    // Keep existing entries so that the call adds to K as the dense version does.
+
+    for (int k=0; k<K.outerSize(); k++)
+        for (SparseMatrix<double>::InnerIterator it(K, k); it; ++it)
+            triplets.emplace_back(it.row(), it.col(), it.value());
+
+    for (auto& buffer : buffers)
+        triplets.insert(triplets.end(), buffer.begin(), buffer.end());
+
+    K.setFromTriplets(triplets.begin(), triplets.end());
+}
+
 void calfem::solveq(const MatrixXd &K, const MatrixXd &f, const VectorXi &bcDofs, const VectorXi &bcValues, MatrixXd &a,
                     MatrixXd &r)
 {
@@ -145,6 +296,75 @@ void calfem::solveq(const MatrixXd &K, const MatrixXd &f, const VectorXi &bcDofs
     r = K*a-f;
 }
 
+calfem::Solver::Solver(const MatrixXd &K, const VectorXi &bcDofs)
+    : m_bcDofs(bcDofs)
+{
+    vector<bool> prescribed(K.rows(), false);
+
+    for (int i=0; i<bcDofs.size(); i++)
+        prescribed[bcDofs(i)] = true;
+
+    Index nPrescribed = std::count(prescribed.begin(), prescribed.end(), true);
+
+    m_prescribedDofs.resize(nPrescribed);
+    m_freeDofs.resize(K.rows()-nPrescribed);
+
+    int nFree = 0;
+    int nBc = 0;
+
+    for (int i=0; i<K.rows(); i++)
+        if (prescribed[i])
+            m_prescribedDofs(nBc++) = i;
+        else
+            m_freeDofs(nFree++) = i;
+
+    // Rows of the prescribed dofs are needed for reactions and prescribed displacements
+
+    m_Kb = K(m_prescribedDofs, Eigen::all);
+    m_ldlt.compute(K(m_freeDofs, m_freeDofs));
+}
+
+void calfem::Solver::solve(const MatrixXd &f, const VectorXd &bcValues, MatrixXd &a, MatrixXd &r) const
+{
+    Index nLoadCases = f.cols();
+
+    VectorXd aPrescribed = VectorXd::Zero(this->dofs());
+
+    for (int i=0; i<m_bcDofs.size(); i++)
+        aPrescribed(m_bcDofs(i)) = bcValues(i);
+
+    MatrixXd ab = aPrescribed(m_prescribedDofs).replicate(1, nLoadCases);
+
+    MatrixXd ff = f(m_freeDofs, Eigen::all);
+
+    if (!ab.isZero(0.0))
+        ff.noalias() -= m_Kb(Eigen::all, m_freeDofs).transpose()*ab;
+
+    MatrixXd af = m_ldlt.solve(ff);
+
+    a.resize(this->dofs(), nLoadCases);
+    a(m_freeDofs, Eigen::all) = af;
+    a(m_prescribedDofs, Eigen::all) = ab;
+
+    r = MatrixXd::Zero(this->dofs(), nLoadCases);
+    r(m_prescribedDofs, Eigen::all) = m_Kb*a-f(m_prescribedDofs, Eigen::all);
+}
+
+void calfem::Solver::solve(const MatrixXd &f, MatrixXd &a, MatrixXd &r) const
+{
+    this->solve(f, VectorXd::Zero(m_bcDofs.size()), a, r);
+}
+
+Index calfem::Solver::dofs() const
+{
+    return m_freeDofs.size()+m_prescribedDofs.size();
+}
+
+const VectorXi& calfem::Solver::freeDofs() const
+{
+    return m_freeDofs;
+}
+
 void calfem::extractEldisp(const MatrixXi &edof, const MatrixXd &a, MatrixXd &ed)
 {
     Index nDofs = edof.cols();
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include <vector>
 
 namespace calfem
 {
@@ -10,9 +13,51 @@ void removeRow(Eigen::MatrixXd &matrix, unsigned int rowToRemove);
 void removeColumn(Eigen::MatrixXd &matrix, unsigned int colToRemove);
 Eigen::MatrixXd hooke(TAnalysisType ptype, double E, double v);
 Eigen::Matrix4d bar2e(const Eigen::Vector2d& ex, const Eigen::Vector2d& ey, const Eigen::Vector2d& ep);
+// Batch variant for n bars stored as struct-of-arrays (row i of ex, ey and ep
+// belongs to bar i). Column r+4*c of the n x 16 result holds Ke(r,c) of all bars.
+void bar2e(const Eigen::MatrixXd& ex, const Eigen::MatrixXd& ey, const Eigen::MatrixXd& ep, Eigen::MatrixXd& Ke);
 double bar2s(const Eigen::Vector2d& ex, const Eigen::Vector2d& ey, const Eigen::Vector2d& ep, const Eigen::Vector4d& ed);
 void assem(const Eigen::MatrixXi& topo, Eigen::MatrixXd& K, const Eigen::MatrixXd& Ke);
+
+// Multithreaded assembly of all elements in edof. Ke uses the batch layout,
+// row i holds the column-major element matrix of element i.
+//
+// colourElements() splits the elements into colours with no shared dofs.
+// The dense assem() processes one colour at a time with the elements of a
+// colour divided between the threads, so no two threads write the same
+// entry of K and the summation order does not depend on the thread count.
+//
+// The sparse assem() gives each thread a contiguous range of elements and a
+// private triplet buffer. The buffers are concatenated in element order
+// before K is built, so the result is identical to a serial assembly.
+
+std::vector<std::vector<int>> colourElements(const Eigen::MatrixXi& edof);
+void assem(const Eigen::MatrixXi& edof, Eigen::MatrixXd& K, const Eigen::MatrixXd& Ke, const std::vector<std::vector<int>>& colours, int nThreads);
+void assem(const Eigen::MatrixXi& edof, Eigen::MatrixXd& K, const Eigen::MatrixXd& Ke, int nThreads);
+void assem(const Eigen::MatrixXi& edof, Eigen::SparseMatrix<double>& K, const Eigen::MatrixXd& Ke, int nThreads);
 void solveq(const Eigen::MatrixXd& K, const Eigen::MatrixXd& f, const Eigen::VectorXi& bcDofs, const Eigen::VectorXi& bcValues, Eigen::MatrixXd& a, Eigen::MatrixXd& r);
+
+// Factor once, solve many. The reduced system and its LDLT factorization are
+// computed in the constructor, each column of f in solve() is a load case.
+
+class Solver
+{
+private:
+    Eigen::VectorXi m_bcDofs;
+    Eigen::VectorXi m_prescribedDofs;
+    Eigen::VectorXi m_freeDofs;
+    Eigen::MatrixXd m_Kb;
+    Eigen::LDLT<Eigen::MatrixXd> m_ldlt;
+public:
+    Solver(const Eigen::MatrixXd& K, const Eigen::VectorXi& bcDofs);
+
+    void solve(const Eigen::MatrixXd& f, const Eigen::VectorXd& bcValues, Eigen::MatrixXd& a, Eigen::MatrixXd& r) const;
+    void solve(const Eigen::MatrixXd& f, Eigen::MatrixXd& a, Eigen::MatrixXd& r) const;
+
+    Eigen::Index dofs() const;
+    const Eigen::VectorXi& freeDofs() const;
+};
+
 void extractEldisp(const Eigen::MatrixXi& edof, const Eigen::MatrixXd& a, Eigen::MatrixXd& ed);
 
 } // namespace calfem
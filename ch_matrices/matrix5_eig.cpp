@@ -131,4 +131,23 @@ int main()
         N(i) = calfem::bar2s(ex.row(i), ey.row(i), ep, ed.row(i));
     
     utils::print("N = ", N);
+
+    // Several load cases against the same factorization. Each column of
+    // the load matrix is a load case.
+
+    MatrixXd F = MatrixXd::Zero(12, 3);
+
+    F.col(0) = f;
+    F(10, 1) = 0.5e6;
+    F(11, 2) = -0.5e6;
+
+    calfem::Solver solver(K, bcDofs);
+
+    MatrixXd aCases;
+    MatrixXd rCases;
+
+    solver.solve(F, aCases, rCases);
+
+    utils::print("aCases =", aCases);
+    utils::print("rCases =", rCases);
 }
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <print>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include "calfem_eig.h"
+
+// Creates a rectangular truss with nx x ny cells. Every cell has a
+// horizontal, a vertical and two diagonal bars.
+
+void createTruss(int nx, int ny, Eigen::MatrixXi& edof, Eigen::MatrixXd& ex, Eigen::MatrixXd& ey)
+{
+    auto node = [nx](int i, int j) { return j * (nx + 1) + i; };
+
+    std::vector<std::pair<int, int>> bars;
+
+    for (int j = 0; j <= ny; j++)
+        for (int i = 0; i <= nx; i++)
+        {
+            if (i < nx)
+                bars.emplace_back(node(i, j), node(i + 1, j));
+            if (j < ny)
+                bars.emplace_back(node(i, j), node(i, j + 1));
+            if ((i < nx) && (j < ny))
+            {
+                bars.emplace_back(node(i, j), node(i + 1, j + 1));
+                bars.emplace_back(node(i + 1, j), node(i, j + 1));
+            }
+        }
+
+    auto nBars = int(bars.size());
+
+    edof.resize(nBars, 4);
+    ex.resize(nBars, 2);
+    ey.resize(nBars, 2);
+
+    for (int e = 0; e < nBars; e++)
+    {
+        auto [n0, n1] = bars[e];
+        edof.row(e) << 2 * n0, 2 * n0 + 1, 2 * n1, 2 * n1 + 1;
+        ex.row(e) << n0 % (nx + 1), n1 % (nx + 1);
+        ey.row(e) << n0 / (nx + 1), n1 / (nx + 1);
+    }
+}
+
+template <typename F> double timeIt(F f, int repeats = 3)
+{
+    double best = 1e300;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        f();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    return best;
+}
+
+std::vector<int> threadCounts()
+{
+    std::vector<int> counts;
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int n = 1; n < maxThreads; n *= 2)
+        counts.push_back(n);
+
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+int main()
+{
+    using Eigen::MatrixXd;
+    using Eigen::MatrixXi;
+    using SparseMatrixXd = Eigen::SparseMatrix<double>;
+
+    // ----- Sparse assembly, 10^5 bars -----
+
+    MatrixXi edof;
+    MatrixXd ex, ey;
+
+    createTruss(250, 100, edof, ex, ey);
+
+    int nDofs = edof.maxCoeff() + 1;
+
+    MatrixXd ep(edof.rows(), 2);
+    ep.col(0).setConstant(2.1e11);
+    ep.col(1).setConstant(25.0e-4);
+
+    MatrixXd Ke;
+
+    double tElements = timeIt([&]() { calfem::bar2e(ex, ey, ep, Ke); });
+
+    std::println("Bars: {}, dofs: {}", edof.rows(), nDofs);
+    std::println("Element matrices (batch bar2e): {:.4f} s", tElements);
+    std::println("");
+    std::println("Sparse assembly (per-thread triplet buffers)");
+    std::println("{:>8} {:>12} {:>10}", "threads", "time [s]", "speedup");
+
+    SparseMatrixXd Kref(nDofs, nDofs);
+    calfem::assem(edof, Kref, Ke, 1);
+
+    double tSerial = 0.0;
+
+    for (auto nThreads : threadCounts())
+    {
+        SparseMatrixXd K(nDofs, nDofs);
+
+        double t = timeIt([&]() {
+            K.setZero();
+            calfem::assem(edof, K, Ke, nThreads);
+        });
+
+        if (nThreads == 1)
+            tSerial = t;
+
+        bool identical = (SparseMatrixXd(K - Kref).norm() == 0.0);
+
+        std::println("{:>8} {:>12.4f} {:>10.2f} {}", nThreads, t, tSerial / t, identical ? "" : "(differs)");
+    }
+
+    // ----- Dense assembly, smaller model -----
+
+    createTruss(40, 40, edof, ex, ey);
+
+    nDofs = edof.maxCoeff() + 1;
+
+    ep.resize(edof.rows(), 2);
+    ep.col(0).setConstant(2.1e11);
+    ep.col(1).setConstant(25.0e-4);
+
+    calfem::bar2e(ex, ey, ep, Ke);
+
+    auto colours = calfem::colourElements(edof);
+
+    std::println("");
+    std::println("Bars: {}, dofs: {}, colours: {}", edof.rows(), nDofs, colours.size());
+    std::println("Dense assembly (element colouring)");
+    std::println("{:>8} {:>12} {:>10}", "threads", "time [s]", "speedup");
+
+    MatrixXd Kdense = MatrixXd::Zero(nDofs, nDofs);
+    calfem::assem(edof, Kdense, Ke, colours, 1);
+
+    for (auto nThreads : threadCounts())
+    {
+        MatrixXd K = MatrixXd::Zero(nDofs, nDofs);
+
+        double t = timeIt([&]() { calfem::assem(edof, K, Ke, colours, nThreads); });
+
+        if (nThreads == 1)
+            tSerial = t;
+
+        K.setZero();
+        calfem::assem(edof, K, Ke, colours, nThreads);
+
+        bool identical = (K == Kdense);
+
+        std::println("{:>8} {:>12.4f} {:>10.2f} {}", nThreads, t, tSerial / t, identical ? "" : "(differs)");
+    }
+}
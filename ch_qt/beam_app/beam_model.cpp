@@ -4,8 +4,6 @@
 
 #include <QDebug>
 
-#include <format>
-
 using namespace Eigen;
 using namespace BeamAnalysis;
 
@@ -48,6 +46,17 @@ Beam::Beam(double l, double E, double A, double I, double q)
     m_A = A;
     m_I = I;
     m_q = q;
+
+    m_maxM = 0.0;
+    m_maxV = 0.0;
+    m_maxv = 0.0;
+
+    m_Ke = Matrix4d::Zero();
+    m_fe = Vector4d::Zero();
+    m_ed = Vector4d::Zero();
+
+    m_stiffnessChanged = true;
+    m_loadChanged = true;
 }
 
 std::shared_ptr<Beam> Beam::create(double l, double E, double A, double I, double q)
@@ -82,6 +91,53 @@ void Beam::setResults(Eigen::MatrixXd& es, Eigen::MatrixXd& edi, Eigen::MatrixXd
     m_maxv = std::max(std::abs(m_edi.maxCoeff()), std::abs(m_edi.minCoeff()));
 }
 
+void Beam::setElement(const Eigen::Matrix4d& Ke, const Eigen::Vector4d& fe)
+{
+    m_Ke = Ke;
+    m_fe = fe;
+}
+
+const Eigen::Matrix4d& Beam::Ke()
+{
+    return m_Ke;
+}
+
+const Eigen::Vector4d& Beam::fe()
+{
+    return m_fe;
+}
+
+void Beam::setDisplacements(const Eigen::Vector4d& ed)
+{
+    m_ed = ed;
+}
+
+const Eigen::Vector4d& Beam::displacements()
+{
+    return m_ed;
+}
+
+bool Beam::stiffnessChanged()
+{
+    return m_stiffnessChanged;
+}
+
+bool Beam::loadChanged()
+{
+    return m_loadChanged;
+}
+
+bool Beam::isChanged()
+{
+    return m_stiffnessChanged || m_loadChanged;
+}
+
+void Beam::clearChanged()
+{
+    m_stiffnessChanged = false;
+    m_loadChanged = false;
+}
+
 int Beam::evalCount()
 {
     return m_es.rows();
@@ -156,12 +212,21 @@ double Beam::I()
 
 void Beam::l(double value)
 {
-    m_l = value;
+    if (value != m_l)
+    {
+        m_l = value;
+        m_stiffnessChanged = true;
+        m_loadChanged = true;
+    }
 }
 
 void Beam::E(double value)
 {
-    m_E = value;
+    if (value != m_E)
+    {
+        m_E = value;
+        m_stiffnessChanged = true;
+    }
 }
 
 void Beam::A(double value)
@@ -171,7 +236,11 @@ void Beam::A(double value)
 
 void Beam::I(double value)
 {
-    m_I = value;
+    if (value != m_I)
+    {
+        m_I = value;
+        m_stiffnessChanged = true;
+    }
 }
 
 double Beam::q()
@@ -181,20 +250,27 @@ double Beam::q()
 
 void Beam::q(double value)
 {
-    m_q = value;
+    if (value != m_q)
+    {
+        m_q = value;
+        m_loadChanged = true;
+    }
 }
 
 BeamModel::BeamModel(int nBeams)
     : m_selectedBeam { nullptr }
+    , m_solverType { SolverType::DENSE }
+    , m_topologyChanged { true }
+    , m_updateTolerance { 1e-12 }
     , m_logger { Logger::getInstance() }
 {
-    m_logger.log(Logger::LogLevel::INFO, "BeamModel created");
+    m_logger.log<Logger::LogLevel::INFO>("BeamModel created");
     this->init_beams(nBeams);
 }
 
 void BeamModel::init_beams(int nBeams)
 {
-    m_logger.log(Logger::LogLevel::INFO, std::format("Initalising {} beams.", nBeams));
+    m_logger.log<Logger::LogLevel::INFO>("Initalising {} beams.", nBeams);
     m_beams.clear();
     m_nodes.clear();
 
@@ -204,6 +280,7 @@ void BeamModel::init_beams(int nBeams)
         m_beams.emplace_back(Beam::create());
     }
     m_nodes.emplace_back(Node::create());
+    m_topologyChanged = true;
 }
 
 std::shared_ptr<BeamModel> BeamModel::create(int nBeams)
@@ -213,7 +290,7 @@ std::shared_ptr<BeamModel> BeamModel::create(int nBeams)
 
 void BeamModel::add(double l)
 {
-    m_logger.log(Logger::LogLevel::INFO, std::format("Adding beam with length {}.", l));
+    m_logger.log<Logger::LogLevel::INFO>("Adding beam with length {}.", l);
 
     m_beams.emplace_back(Beam::create(l));
     m_nodes.emplace_back(Node::create());
@@ -223,7 +300,7 @@ void BeamModel::add(double l)
 
 void BeamModel::removeLast()
 {
-    m_logger.log(Logger::LogLevel::INFO, "Removing last beam.");
+    m_logger.log<Logger::LogLevel::INFO>("Removing last beam.");
 
     if (m_beams.size() > 1)
     {
@@ -331,9 +408,30 @@ int BeamModel::beam_pos_from_x(double x)
     return -1;
 }
 
+void BeamModel::setSolverType(SolverType solverType)
+{
+    m_solverType = solverType;
+    m_topologyChanged = true;
+}
+
+SolverType BeamModel::solverType()
+{
+    return m_solverType;
+}
+
+void BeamModel::setUpdateTolerance(double tolerance)
+{
+    m_updateTolerance = tolerance;
+}
+
+double BeamModel::updateTolerance()
+{
+    return m_updateTolerance;
+}
+
 void BeamModel::connect()
 {
-    m_logger.log(Logger::LogLevel::INFO, "Connecting nodes and beams.");
+    m_logger.log<Logger::LogLevel::INFO>("Connecting nodes and beams.");
 
     auto dof = 1;
 
@@ -347,81 +445,308 @@ void BeamModel::connect()
         beam->setNodes(m_nodes[i], m_nodes[i + 1]);
         i++;
     }
+
+    m_topologyChanged = true;
+}
+
+Vector4i BeamModel::topo(BeamPtr& beam)
+{
+    Vector4i topo;
+    topo << beam->n0()->dof(0) - 1, beam->n0()->dof(1) - 1, beam->n1()->dof(0) - 1, beam->n1()->dof(1) - 1;
+    return topo;
+}
+
+void BeamModel::element(BeamPtr& beam, Matrix4d& Ke, Vector4d& fe)
+{
+    Vector2d ex;
+    Vector2d ep;
+
+    ex << 0.0, beam->l();
+    ep << beam->E(), beam->I();
+
+    calfem::beam1e(ex, ep, Ke, fe, beam->q());
 }
 
 void BeamModel::solve()
 {
-    m_logger.log(Logger::LogLevel::INFO, "Solving beam model.");
+    m_logger.log<Logger::LogLevel::INFO>("Solving beam model.");
 
     auto nDofs = (m_beams.size() + 1) * 2;
 
-    MatrixXd K(nDofs, nDofs);
-    K = MatrixXd::Zero(nDofs, nDofs);
+    calfem::TripletList Kt;
+
+    if (m_solverType == SolverType::SPARSE)
+    {
+        m_K.resize(0, 0);
+        Kt.reserve(m_beams.size() * 16);
+    }
+    else
+        m_K = MatrixXd::Zero(nDofs, nDofs);
 
-    MatrixXd f(nDofs, 1);
-    f = MatrixXd::Zero(nDofs, 1);
+    m_f = MatrixXd::Zero(nDofs, 1);
+
+    Matrix4d Ke;
+    Vector4d fe;
+
+    for (auto& beam : m_beams)
+    {
+        this->element(beam, Ke, fe);
+
+        if (m_solverType == SolverType::SPARSE)
+            calfem::assem(this->topo(beam), Kt, Ke, m_f, fe);
+        else
+            calfem::assem(this->topo(beam), m_K, Ke, m_f, fe);
+
+        beam->setElement(Ke, fe);
+    }
+
+    if (m_solverType == SolverType::SPARSE)
+    {
+        m_Ks.resize(nDofs, nDofs);
+        m_Ks.setFromTriplets(Kt.begin(), Kt.end());
+    }
+    else
+        m_Ks.resize(0, 0);
+
+    this->factorize();
+    this->solveDisplacements();
+    this->postProcess(true);
+
+    m_topologyChanged = false;
+}
+
+void BeamModel::update()
+{
+    if (m_topologyChanged)
+    {
+        this->solve();
+        return;
+    }
 
     Matrix4d Ke;
     Vector4d fe;
-    Vector2d ex;
-    Vector2d ep;
-    Vector4i topo;
 
-    auto x = 0.0;
+    auto nChanged = 0;
+    auto refactorize = false;
 
     for (auto& beam : m_beams)
     {
-        ex << x, x + beam->l();
-        ep << beam->E(), beam->I();
-        auto eq = beam->q();
-        topo << beam->n0()->dof(0) - 1, beam->n0()->dof(1) - 1, beam->n1()->dof(0) - 1, beam->n1()->dof(1) - 1;
+        if (!beam->isChanged())
+            continue;
+
+        nChanged++;
+
+        this->element(beam, Ke, fe);
+        auto topo = this->topo(beam);
+
+        if (beam->loadChanged())
+        {
+            Vector4d dfe = fe - beam->fe();
+
+            for (auto i = 0; i < 4; i++)
+                m_f(topo(i), 0) += dfe(i);
+        }
 
-        calfem::beam1e(ex, ep, Ke, fe, eq);
-        calfem::assem(topo, K, Ke, f, fe);
+        if (beam->stiffnessChanged())
+        {
+            Matrix4d dKe = Ke - beam->Ke();
+
+            for (auto i = 0; i < 4; i++)
+                for (auto j = 0; j < 4; j++)
+                    if (m_solverType == SolverType::SPARSE)
+                        m_Ks.coeffRef(topo(i), topo(j)) += dKe(i, j);
+                    else
+                        m_K(topo(i), topo(j)) += dKe(i, j);
+
+            this->updateFactorization(topo, dKe);
+            refactorize = refactorize || (m_solverType == SolverType::SPARSE);
+        }
+
+        beam->setElement(Ke, fe);
     }
 
-    auto nBcDofs = m_beams.size() + 1;
+    if (nChanged == 0)
+        return;
+
+    m_logger.log<Logger::LogLevel::INFO>("Updating beam model ({} changed beams).", nChanged);
+
+    // The sparse factorization of the banded system is linear in the number
+    // of dofs, so only the numerical phase is redone. The symbolic analysis
+    // is reused.
 
-    VectorXi bcDofs(nBcDofs);
-    bcDofs = VectorXi::Zero(nBcDofs);
+    if (refactorize)
+        m_sparseLdlt.factorize(m_Kred);
 
-    VectorXd bcValues(nBcDofs);
-    bcValues = VectorXd::Zero(nBcDofs);
+    this->solveDisplacements();
+    this->postProcess(false);
+}
+
+void BeamModel::factorize()
+{
+    auto nDofs = m_f.rows();
+
+    // Vertical displacements are prescribed at all supports.
+
+    m_freeIndex.assign(nDofs, 0);
+
+    for (auto& node : m_nodes)
+        m_freeIndex[node->dof(0) - 1] = -1;
+
+    m_freeDofs.resize(nDofs);
+
+    auto count = 0;
+
+    for (auto i = 0; i < nDofs; i++)
+        if (m_freeIndex[i] != -1)
+        {
+            m_freeIndex[i] = count;
+            m_freeDofs(count++) = i;
+        }
 
-    auto dof = 0;
+    m_freeDofs.conservativeResize(count);
 
-    for (auto i = 0; i < nBcDofs; i++)
+    if (m_solverType == SolverType::SPARSE)
     {
-        bcDofs(i) = dof;
-        dof += 2;
+        calfem::TripletList reduced;
+        reduced.reserve(m_Ks.nonZeros());
+
+        for (auto col = 0; col < m_Ks.outerSize(); col++)
+            for (calfem::SparseMatrixXd::InnerIterator it(m_Ks, col); it; ++it)
+                if ((m_freeIndex[it.row()] != -1) && (m_freeIndex[it.col()] != -1))
+                    reduced.emplace_back(m_freeIndex[it.row()], m_freeIndex[it.col()], it.value());
+
+        m_Kred.resize(count, count);
+        m_Kred.setFromTriplets(reduced.begin(), reduced.end());
+
+        m_sparseLdlt.analyzePattern(m_Kred);
+        m_sparseLdlt.factorize(m_Kred);
+    }
+    else
+    {
+        MatrixXd Ksolve(count, count);
+
+        for (auto i = 0; i < count; i++)
+            for (auto j = 0; j < count; j++)
+                Ksolve(i, j) = m_K(m_freeDofs(i), m_freeDofs(j));
+
+        m_denseLdlt.compute(Ksolve);
     }
+}
 
-    MatrixXd a(nDofs, 1);
-    a = MatrixXd::Zero(nDofs, 1);
+void BeamModel::updateFactorization(const Vector4i& topo, const Matrix4d& dKe)
+{
+    // Restrict the element change to the free dofs.
 
-    MatrixXd R(nDofs, 1);
-    R = MatrixXd::Zero(nDofs, 1);
+    int idx[4];
+    auto n = 0;
 
-    calfem::solveq(K, f, bcDofs, bcValues, a, R);
+    for (auto i = 0; i < 4; i++)
+        if (m_freeIndex[topo(i)] != -1)
+            idx[n++] = i;
 
-    auto nep = 100;
+    if (n == 0)
+        return;
 
+    MatrixXd dKr(n, n);
+
+    for (auto i = 0; i < n; i++)
+        for (auto j = 0; j < n; j++)
+            dKr(i, j) = dKe(idx[i], idx[j]);
+
+    if (m_solverType == SolverType::SPARSE)
+    {
+        for (auto i = 0; i < n; i++)
+            for (auto j = 0; j < n; j++)
+                m_Kred.coeffRef(m_freeIndex[topo(idx[i])], m_freeIndex[topo(idx[j])]) += dKr(i, j);
+        return;
+    }
+
+    // Dense path: the symmetric element change has rank <= 4 and is applied
+    // as a sequence of rank-one updates of the existing LDLT factorization.
+
+    SelfAdjointEigenSolver<MatrixXd> eig(dKr);
+
+    auto tol = m_updateTolerance * eig.eigenvalues().cwiseAbs().maxCoeff();
+
+    VectorXd w = VectorXd::Zero(m_freeDofs.size());
+
+    for (auto k = 0; k < n; k++)
+    {
+        auto lambda = eig.eigenvalues()(k);
+
+        if (std::abs(lambda) <= tol)
+            continue;
+
+        for (auto i = 0; i < n; i++)
+            w(m_freeIndex[topo(idx[i])]) = eig.eigenvectors()(i, k);
+
+        m_denseLdlt.rankUpdate(w, lambda);
+
+        for (auto i = 0; i < n; i++)
+            w(m_freeIndex[topo(idx[i])]) = 0.0;
+    }
+
+    // Eigen does not report failed rank updates, so check that the updated
+    // factor still describes a positive definite system.
+
+    if (!(m_denseLdlt.vectorD().array() > 0.0).all())
+    {
+        m_logger.log<Logger::LogLevel::WARNING>("Rank update failed, refactorizing.");
+        this->factorize();
+    }
+}
+
+void BeamModel::solveDisplacements()
+{
+    auto count = m_freeDofs.size();
+
+    VectorXd fsolve(count);
+
+    for (auto i = 0; i < count; i++)
+        fsolve(i) = m_f(m_freeDofs(i), 0);
+
+    VectorXd asolve;
+
+    if (m_solverType == SolverType::SPARSE)
+        asolve = m_sparseLdlt.solve(fsolve);
+    else
+        asolve = m_denseLdlt.solve(fsolve);
+
+    m_a = MatrixXd::Zero(m_f.rows(), 1);
+
+    for (auto i = 0; i < count; i++)
+        m_a(m_freeDofs(i), 0) = asolve(i);
+}
+
+void BeamModel::postProcess(bool all)
+{
+    // Only beams that were edited or whose end displacements moved more than
+    // the update tolerance are re-sampled.
+
+    auto tol = m_updateTolerance * m_a.cwiseAbs().maxCoeff();
+
+    Vector2d ex;
+    Vector2d ep;
     Vector4d ed;
-    MatrixXd es(nep, 2);
-    VectorXd edi(nep);
-    VectorXd eci(nep);
 
     for (auto& beam : m_beams)
     {
-        ex << x, x + beam->l();
-        ep << beam->E(), beam->I();
-        auto eq = beam->q();
-        ed << a(beam->n0()->dof(0) - 1), a(beam->n0()->dof(1) - 1), a(beam->n1()->dof(0) - 1),
-            a(beam->n1()->dof(1) - 1);
+        auto topo = this->topo(beam);
+
+        ed << m_a(topo(0), 0), m_a(topo(1), 0), m_a(topo(2), 0), m_a(topo(3), 0);
+
+        if (all || beam->isChanged() || ((ed - beam->displacements()).cwiseAbs().maxCoeff() > tol))
+        {
+            ex << 0.0, beam->l();
+            ep << beam->E(), beam->I();
+
+            MatrixXd es, edi, eci;
+            calfem::beam1s(ex, ep, ed, es, edi, eci, beam->q(), 100);
 
-        MatrixXd es, edi, eci;
-        calfem::beam1s(ex, ep, ed, es, edi, eci, eq, 100);
+            beam->setResults(es, edi, eci);
+            beam->setDisplacements(ed);
+        }
 
-        beam->setResults(es, edi, eci);
+        beam->clearChanged();
     }
 }
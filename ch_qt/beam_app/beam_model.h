@@ -6,7 +6,9 @@
 #include <vector>
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
+#include "calfem.h"
 #include "logger.h"
 
 namespace BeamAnalysis
@@ -50,6 +52,16 @@ private:
     double m_maxV;
     double m_maxv;
 
+    // Element contribution currently assembled in the global system and the
+    // end displacements used for the stored results.
+
+    Eigen::Matrix4d m_Ke;
+    Eigen::Vector4d m_fe;
+    Eigen::Vector4d m_ed;
+
+    bool m_stiffnessChanged;
+    bool m_loadChanged;
+
 public:
     Beam(double l = 1.0, double E = 2.1e9, double A = 0.01, double I = 8.33e-6, double q = -1.0e3);
 
@@ -62,6 +74,18 @@ public:
 
     void setResults(Eigen::MatrixXd &es, Eigen::MatrixXd &edi, Eigen::MatrixXd &eci);
 
+    void setElement(const Eigen::Matrix4d &Ke, const Eigen::Vector4d &fe);
+    const Eigen::Matrix4d &Ke();
+    const Eigen::Vector4d &fe();
+
+    void setDisplacements(const Eigen::Vector4d &ed);
+    const Eigen::Vector4d &displacements();
+
+    bool stiffnessChanged();
+    bool loadChanged();
+    bool isChanged();
+    void clearChanged();
+
     int evalCount();
     double M(int idx);
     double V(int idx);
@@ -90,6 +114,12 @@ public:
 
 typedef std::shared_ptr<Beam> BeamPtr;
 
+enum class SolverType
+{
+    DENSE,
+    SPARSE
+};
+
 class BeamModel
 {
 private:
@@ -98,9 +128,36 @@ private:
     std::vector<NodePtr> m_nodes;
 
     BeamPtr m_selectedBeam;
+    SolverType m_solverType;
+
+    // Cached global system, reused by update() as long as the topology
+    // (number of beams and dof numbering) is unchanged.
+
+    bool m_topologyChanged;
+    double m_updateTolerance;
+
+    Eigen::MatrixXd m_K;
+    calfem::SparseMatrixXd m_Ks;
+    Eigen::MatrixXd m_f;
+    Eigen::MatrixXd m_a;
+
+    std::vector<int> m_freeIndex;
+    Eigen::VectorXi m_freeDofs;
+
+    calfem::SparseMatrixXd m_Kred;
+    Eigen::LDLT<Eigen::MatrixXd> m_denseLdlt;
+    Eigen::SimplicialLDLT<calfem::SparseMatrixXd> m_sparseLdlt;
 
     void init_beams(int nBeams);
 
+    Eigen::Vector4i topo(BeamPtr &beam);
+    void element(BeamPtr &beam, Eigen::Matrix4d &Ke, Eigen::Vector4d &fe);
+
+    void factorize();
+    void updateFactorization(const Eigen::Vector4i &topo, const Eigen::Matrix4d &dKe);
+    void solveDisplacements();
+    void postProcess(bool all);
+
 public:
     BeamModel(int nBeams);
 
@@ -124,9 +181,16 @@ public:
 
     int beam_pos_from_x(double x);
 
+    void setSolverType(SolverType solverType);
+    SolverType solverType();
+
+    void setUpdateTolerance(double tolerance);
+    double updateTolerance();
+
     void connect();
 
     void solve();
+    void update();
 };
 
 typedef std::shared_ptr<BeamModel> BeamModelPtr;
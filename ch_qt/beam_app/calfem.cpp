@@ -1,7 +1,9 @@
 #include "calfem.h"
 
+#include <algorithm>
 #include <cmath>
 #include <set>
+#include <vector>
 
 using namespace Eigen;
 using namespace std;
@@ -144,6 +146,147 @@ void solveq(const MatrixXd &K, const MatrixXd &f, const VectorXi &bcDofs, const
     r = K * a - f;
 }
 
+Solver::Solver(const MatrixXd &K, const VectorXi &bcDofs)
+    : m_bcDofs(bcDofs)
+{
+    vector<bool> prescribed(K.rows(), false);
+
+    for (int i = 0; i < bcDofs.size(); i++)
+        prescribed[bcDofs(i)] = true;
+
+    Index nPrescribed = std::count(prescribed.begin(), prescribed.end(), true);
+
+    m_prescribedDofs.resize(nPrescribed);
+    m_freeDofs.resize(K.rows() - nPrescribed);
+
+    int nFree = 0;
+    int nBc = 0;
+
+    for (int i = 0; i < K.rows(); i++)
+        if (prescribed[i])
+            m_prescribedDofs(nBc++) = i;
+        else
+            m_freeDofs(nFree++) = i;
+
+    // Rows of the prescribed dofs are kept for the reactions and for moving
+    // prescribed displacements to the right hand side.
+
+    m_Kb = K(m_prescribedDofs, Eigen::all);
+    m_ldlt.compute(K(m_freeDofs, m_freeDofs));
+}
+
+void Solver::solve(const MatrixXd &f, const VectorXd &bcValues, MatrixXd &a, MatrixXd &r) const
+{
+    Index nLoadCases = f.cols();
+
+    VectorXd aPrescribed = VectorXd::Zero(this->dofs());
+
+    for (int i = 0; i < m_bcDofs.size(); i++)
+        aPrescribed(m_bcDofs(i)) = bcValues(i);
+
+    MatrixXd ab = aPrescribed(m_prescribedDofs).replicate(1, nLoadCases);
+
+    MatrixXd ff = f(m_freeDofs, Eigen::all);
+
+    if (!ab.isZero(0.0))
+        ff.noalias() -= m_Kb(Eigen::all, m_freeDofs).transpose() * ab;
+
+    MatrixXd af = m_ldlt.solve(ff);
+
+    a.resize(this->dofs(), nLoadCases);
+    a(m_freeDofs, Eigen::all) = af;
+    a(m_prescribedDofs, Eigen::all) = ab;
+
+    r = MatrixXd::Zero(this->dofs(), nLoadCases);
+    r(m_prescribedDofs, Eigen::all) = m_Kb * a - f(m_prescribedDofs, Eigen::all);
+}
+
+void Solver::solve(const MatrixXd &f, MatrixXd &a, MatrixXd &r) const
+{
+    this->solve(f, VectorXd::Zero(m_bcDofs.size()), a, r);
+}
+
+Index Solver::dofs() const
+{
+    return m_freeDofs.size() + m_prescribedDofs.size();
+}
+
+const VectorXi &Solver::freeDofs() const
+{
+    return m_freeDofs;
+}
+
+void assem(const VectorXi &topo, TripletList &K, const MatrixXd &Ke, MatrixXd &f, const MatrixXd &fe)
+{
+    for (int row = 0; row < Ke.rows(); row++)
+        for (int col = 0; col < Ke.cols(); col++)
+            K.emplace_back(topo(row), topo(col), Ke(row, col));
+
+    for (int row = 0; row < fe.rows(); row++)
+        f(topo(row)) += fe(row);
+}
+
+void solveq(const SparseMatrixXd &K, const MatrixXd &f, const VectorXi &bcDofs, const VectorXd &bcValues, MatrixXd &a,
+            MatrixXd &r)
+{
+    // Map global dofs to reduced (free) dofs, -1 marks a prescribed dof.
+
+    vector<int> freeIndex(K.rows(), 0);
+    VectorXd aPrescribed = VectorXd::Zero(K.rows());
+
+    for (int i = 0; i < bcDofs.size(); i++)
+    {
+        freeIndex[bcDofs(i)] = -1;
+        aPrescribed(bcDofs(i)) = bcValues(i);
+    }
+
+    VectorXi allIndices(K.rows());
+
+    int count = 0;
+
+    for (int i = 0; i < K.rows(); i++)
+        if (freeIndex[i] != -1)
+        {
+            freeIndex[i] = count;
+            allIndices(count++) = i;
+        }
+
+    VectorXd fsolve(count);
+
+    for (int i = 0; i < count; i++)
+        fsolve(i) = f(allIndices(i), 0);
+
+    // Couplings to prescribed dofs move to the right-hand side, as in Solver
+
+    TripletList reduced;
+    reduced.reserve(K.nonZeros());
+
+    for (int col = 0; col < K.outerSize(); col++)
+        for (SparseMatrixXd::InnerIterator it(K, col); it; ++it)
+        {
+            if (freeIndex[it.row()] == -1)
+                continue;
+
+            if (freeIndex[it.col()] != -1)
+                reduced.emplace_back(freeIndex[it.row()], freeIndex[it.col()], it.value());
+            else
+                fsolve(freeIndex[it.row()]) -= it.value() * aPrescribed(it.col());
+        }
+
+    SparseMatrixXd Ksolve(count, count);
+    Ksolve.setFromTriplets(reduced.begin(), reduced.end());
+
+    SimplicialLDLT<SparseMatrixXd> ldlt(Ksolve);
+    VectorXd asolve = ldlt.solve(fsolve);
+
+    a = aPrescribed;
+
+    for (int i = 0; i < count; i++)
+        a(allIndices(i), 0) = asolve(i);
+
+    r = K * a - f;
+}
+
 void extractEldisp(const MatrixXi &edof, const MatrixXd &a, MatrixXd &ed)
 {
     Index nDofs = edof.cols();
@@ -170,7 +313,7 @@ void beam1e(const Eigen::Vector2d &ex, const Eigen::Vector2d &ep, Eigen::Matrix4
 
     Ke = Matrix4d::Zero();
 
-    Ke << 2, 6 * L, -12, 6 * L, 6 * L, 4 * L * L, -6 * L, 2 * L * L, -12, -6 * L, 12, -6 * L, 6 * L, 2 * L * L, -6 * L,
+    Ke << 12, 6 * L, -12, 6 * L, 6 * L, 4 * L * L, -6 * L, 2 * L * L, -12, -6 * L, 12, -6 * L, 6 * L, 2 * L * L, -6 * L,
         4 * L * L;
 
     Ke = Ke * DEI / std::pow(L, 3);
@@ -244,4 +387,116 @@ void beam1s(const Eigen::VectorXd &ex, const Eigen::VectorXd &ep, const Eigen::V
     eci = X;
 }
 
+void bar2e(const MatrixXd &ex, const MatrixXd &ey, const MatrixXd &ep, MatrixXd &Ke)
+{
+    Index n = ex.rows();
+
+    ArrayXd dx = ex.col(1).array() - ex.col(0).array();
+    ArrayXd dy = ey.col(1).array() - ey.col(0).array();
+    ArrayXd L2 = dx.square() + dy.square();
+
+    // C * nxx^2, C * nxx * nyx and C * nyx^2 with C = E * A / L
+
+    ArrayXd C = ep.col(0).array() * ep.col(1).array() / (L2 * L2.sqrt());
+    ArrayXd kxx = C * dx.square();
+    ArrayXd kxy = C * dx * dy;
+    ArrayXd kyy = C * dy.square();
+
+    Ke.resize(n, 16);
+
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+        {
+            const ArrayXd &k = (r % 2 == 0) ? ((c % 2 == 0) ? kxx : kxy) : ((c % 2 == 0) ? kxy : kyy);
+
+            if ((r < 2) == (c < 2))
+                Ke.col(r + 4 * c) = k.matrix();
+            else
+                Ke.col(r + 4 * c) = -k.matrix();
+        }
+}
+
+void beam1e(const MatrixXd &ex, const MatrixXd &ep, const VectorXd &eq, MatrixXd &Ke, MatrixXd &fe)
+{
+    Index n = ex.rows();
+
+    ArrayXd L = (ex.col(1).array() - ex.col(0).array()).abs();
+    ArrayXd k = ep.col(0).array() * ep.col(1).array() / L.cube();
+    ArrayXd kL = k * L;
+    ArrayXd kL2 = kL * L;
+
+    Ke.resize(n, 16);
+
+    Ke.col(0) = 12 * k;
+    Ke.col(1) = 6 * kL;
+    Ke.col(2) = -12 * k;
+    Ke.col(3) = 6 * kL;
+
+    Ke.col(4) = 6 * kL;
+    Ke.col(5) = 4 * kL2;
+    Ke.col(6) = -6 * kL;
+    Ke.col(7) = 2 * kL2;
+
+    Ke.col(8) = -12 * k;
+    Ke.col(9) = -6 * kL;
+    Ke.col(10) = 12 * k;
+    Ke.col(11) = -6 * kL;
+
+    Ke.col(12) = 6 * kL;
+    Ke.col(13) = 2 * kL2;
+    Ke.col(14) = -6 * kL;
+    Ke.col(15) = 4 * kL2;
+
+    ArrayXd q = eq.array();
+
+    fe.resize(n, 4);
+
+    fe.col(0) = q * L / 2;
+    fe.col(1) = q * L.square() / 12;
+    fe.col(2) = q * L / 2;
+    fe.col(3) = -q * L.square() / 12;
+}
+
+void beam1s(const MatrixXd &ex, const MatrixXd &ep, const MatrixXd &ed, const VectorXd &eq, MatrixXd &M, MatrixXd &V,
+            MatrixXd &v, MatrixXd &x, int nep)
+{
+    Index n = ex.rows();
+
+    ArrayXd L = (ex.col(1).array() - ex.col(0).array()).abs();
+    ArrayXd DEI = ep.col(0).array() * ep.col(1).array();
+
+    // Polynomial coefficients C2 * ed of the homogeneous solution
+
+    ArrayXd c0 = ed.col(0).array();
+    ArrayXd c1 = ed.col(1).array();
+    ArrayXd c2 = (-3 * ed.col(0).array() + 3 * ed.col(2).array()) / L.square() -
+                 (2 * ed.col(1).array() + ed.col(3).array()) / L;
+    ArrayXd c3 = (2 * ed.col(0).array() - 2 * ed.col(2).array()) / L.cube() +
+                 (ed.col(1).array() + ed.col(3).array()) / L.square();
+
+    // Particular solution from the distributed load, q / DEI
+
+    ArrayXd qd = (DEI != 0.0).select(eq.array() / DEI, 0.0);
+
+    M.resize(n, nep);
+    V.resize(n, nep);
+    v.resize(n, nep);
+    x.resize(n, nep);
+
+    ArrayXd X(n);
+
+    for (int j = 0; j < nep; j++)
+    {
+        if (nep > 1)
+            X = L * (double(j) / double(nep - 1));
+        else
+            X = L;
+
+        v.col(j) = (c0 + X * (c1 + X * (c2 + X * c3)) + X.square() * (X - L).square() * qd / 24).matrix();
+        M.col(j) = (DEI * (2 * c2 + 6 * c3 * X) + (6 * X.square() - 6 * L * X + L.square()) * DEI * qd / 12).matrix();
+        V.col(j) = (-DEI * 6 * c3 - (2 * X - L) * DEI * qd / 2).matrix();
+        x.col(j) = X.matrix();
+    }
+}
+
 } // namespace calfem
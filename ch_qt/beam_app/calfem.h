@@ -1,6 +1,9 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+#include <vector>
 
 namespace calfem
 {
@@ -24,12 +27,65 @@ void beam1e(const Eigen::Vector2d &ex, const Eigen::Vector2d &ep, Eigen::Matrix4
 void beam1s(const Eigen::VectorXd &ex, const Eigen::VectorXd &ep, const Eigen::VectorXd &ed, Eigen::MatrixXd &es,
             Eigen::MatrixXd &edi, Eigen::MatrixXd &eci, double eq, int nep = 2);
 
+// Batch variants for n elements stored as struct-of-arrays. Row i of ex, ey,
+// ep, eq and ed holds the data of element i, so every column is contiguous
+// and the kernels are evaluated column-wise with Eigen's vectorized array
+// expressions. Element matrices are returned as n x 16 matrices where column
+// r + 4 * c holds Ke(r, c) of all elements. Section forces and deflections
+// are returned as n x nep matrices with one column per evaluation point.
+
+void bar2e(const Eigen::MatrixXd &ex, const Eigen::MatrixXd &ey, const Eigen::MatrixXd &ep, Eigen::MatrixXd &Ke);
+
+void beam1e(const Eigen::MatrixXd &ex, const Eigen::MatrixXd &ep, const Eigen::VectorXd &eq, Eigen::MatrixXd &Ke,
+            Eigen::MatrixXd &fe);
+
+void beam1s(const Eigen::MatrixXd &ex, const Eigen::MatrixXd &ep, const Eigen::MatrixXd &ed, const Eigen::VectorXd &eq,
+            Eigen::MatrixXd &M, Eigen::MatrixXd &V, Eigen::MatrixXd &v, Eigen::MatrixXd &x, int nep = 2);
+
 void assem(const Eigen::VectorXi &topo, Eigen::MatrixXd &K, const Eigen::MatrixXd &Ke, Eigen::MatrixXd &f,
            const Eigen::MatrixXd &fe);
 
 void solveq(const Eigen::MatrixXd &K, const Eigen::MatrixXd &f, const Eigen::VectorXi &bcDofs,
             const Eigen::VectorXd &bcValues, Eigen::MatrixXd &a, Eigen::MatrixXd &r);
 
+// Factor once, solve many. The free-dof index set, the reduced stiffness
+// matrix and its LDLT factorization are computed in the constructor. Each
+// column of the load matrix passed to solve() is a separate load case, all
+// columns are solved in a single pass against the cached factorization.
+
+class Solver
+{
+private:
+    Eigen::VectorXi m_bcDofs;
+    Eigen::VectorXi m_prescribedDofs;
+    Eigen::VectorXi m_freeDofs;
+    Eigen::MatrixXd m_Kb;
+    Eigen::LDLT<Eigen::MatrixXd> m_ldlt;
+
+public:
+    Solver(const Eigen::MatrixXd &K, const Eigen::VectorXi &bcDofs);
+
+    void solve(const Eigen::MatrixXd &f, const Eigen::VectorXd &bcValues, Eigen::MatrixXd &a,
+               Eigen::MatrixXd &r) const;
+    void solve(const Eigen::MatrixXd &f, Eigen::MatrixXd &a, Eigen::MatrixXd &r) const;
+
+    Eigen::Index dofs() const;
+    const Eigen::VectorXi &freeDofs() const;
+};
+
+// Sparse variants. Element matrices are collected as triplets and summed when
+// the sparse matrix is built, so assembly and solution scale with the number
+// of non-zeros instead of nDofs^2.
+
+typedef Eigen::SparseMatrix<double> SparseMatrixXd;
+typedef std::vector<Eigen::Triplet<double>> TripletList;
+
+void assem(const Eigen::VectorXi &topo, TripletList &K, const Eigen::MatrixXd &Ke, Eigen::MatrixXd &f,
+           const Eigen::MatrixXd &fe);
+
+void solveq(const SparseMatrixXd &K, const Eigen::MatrixXd &f, const Eigen::VectorXi &bcDofs,
+            const Eigen::VectorXd &bcValues, Eigen::MatrixXd &a, Eigen::MatrixXd &r);
+
 void extractEldisp(const Eigen::MatrixXi &edof, const Eigen::MatrixXd &a, Eigen::MatrixXd &ed);
 
 } // namespace calfem
@@ -1,10 +1,27 @@
 #include "logger.h"
 
-#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
+
+namespace
+{
+constexpr std::size_t messageCapacity = 240; // Longer messages are truncated in asynchronous mode
+constexpr std::size_t maxBatch = 256;        // Messages formatted per write
+}
+
+// Ring slot, the sequence number tells whether the slot is free or holds a
+// message for the current lap (see LockFreeQueue in ch_concurrency)
+struct Logger::Slot
+{
+    std::atomic<std::size_t> sequence;
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::size_t length;
+    char text[messageCapacity];
+};
 
 Logger::Logger()
     : currentLogLevel(LogLevel::INFO)
@@ -13,6 +30,8 @@ Logger::Logger()
 
 Logger::~Logger()
 {
+    setAsync(false);
+
     if (logFile.is_open())
     {
         logFile.close();
@@ -40,45 +59,340 @@ void Logger::setLogFile(const std::string& filename)
     logFile.open(filename, std::ios::app);
 }
 
-void Logger::log(LogLevel level, const std::string& message)
+void Logger::log(LogLevel level, std::string_view message)
 {
-    if (level >= currentLogLevel)
+    if (level < currentLogLevel.load(std::memory_order_relaxed))
+        return;
+
+    if (async.load(std::memory_order_acquire))
     {
-        std::lock_guard<std::mutex> lock(mtx);
-        std::string timestamp = getCurrentTimestamp();
-        std::string levelStr = getLevelString(level);
+        std::size_t pos;
 
-        std::stringstream ss;
-        ss << timestamp << " [" << levelStr << "] " << message << std::endl;
+        while (!tryEnqueue(level, message, pos))
+        {
+            if (overflowPolicy.load(std::memory_order_relaxed) == OverflowPolicy::DROP)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                totalDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            if (writerSleeping.load(std::memory_order_relaxed))
+                wakeCond.notify_one();
+
+            std::this_thread::yield();
+        }
+
+        // The writer wakes up on its own every flushInterval. It is only
+        // woken early when another half ring of messages has been queued.
+
+        if ((((pos + 1) & (slotMask >> 1)) == 0) && writerSleeping.load(std::memory_order_relaxed))
+            wakeCond.notify_one();
+
+        return;
+    }
+
+    // Formatted into a reused buffer instead of a stringstream
+
+    thread_local std::string line;
+
+    line.clear();
+    appendTimestamp(line, std::chrono::system_clock::now());
+    line += " [";
+    line += getLevelString(level);
+    line += "] ";
+    line += message;
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (logFile.is_open())
+    {
+        logFile << line;
+        logFile.flush();
+    }
+
+    std::lock_guard<std::mutex> consoleLock(consoleMtx);
+    std::cout << line << std::flush;
+}
+
+void Logger::setAsync(bool enabled, std::size_t capacity)
+{
+    if (enabled == async.load())
+        return;
+
+    if (enabled)
+    {
+        std::size_t size = 4;
+        while (size < capacity)
+            size *= 2;
+
+        slots = std::make_unique<Slot[]>(size);
+        slotMask = size - 1;
+
+        for (std::size_t i = 0; i < size; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+
+        enqueuePos.store(0);
+        dequeuePos = 0;
+        flushedPos.store(0);
+        dropped.store(0);
+        stopping.store(false);
+
+        writer = std::thread(&Logger::writerLoop, this);
+        async.store(true, std::memory_order_release);
+    }
+    else
+    {
+        // The writer drains the ring and flushes before it exits
+
+        async.store(false);
 
-        if (logFile.is_open())
         {
-            logFile << ss.str();
-            logFile.flush();
+            std::lock_guard<std::mutex> lock(wakeMtx);
+            stopping.store(true);
         }
-        std::cout << ss.str();
+        wakeCond.notify_one();
+
+        writer.join();
+        slots.reset();
+    }
+}
+
+bool Logger::isAsync() const
+{
+    return async.load();
+}
+
+void Logger::setOverflowPolicy(OverflowPolicy policy)
+{
+    overflowPolicy.store(policy, std::memory_order_relaxed);
+}
+
+void Logger::setFlushInterval(std::chrono::milliseconds interval)
+{
+    flushInterval.store(interval, std::memory_order_relaxed);
+}
+
+void Logger::flush()
+{
+    if (!async.load())
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (logFile.is_open())
+            logFile.flush();
+        return;
+    }
+
+    std::size_t target = enqueuePos.load();
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMtx);
+        flushRequests.fetch_add(1);
+    }
+    wakeCond.notify_one();
+
+    {
+        std::unique_lock<std::mutex> lock(wakeMtx);
+        flushedCond.wait(lock, [this, target]() { return flushedPos.load() >= target; });
     }
+
+    flushRequests.fetch_sub(1);
 }
 
-std::string Logger::getCurrentTimestamp()
+std::size_t Logger::droppedMessages() const
+{
+    return totalDropped.load();
+}
+
+std::mutex& Logger::consoleMutex()
+{
+    return consoleMtx;
+}
+
+bool Logger::tryEnqueue(LogLevel level, std::string_view message, std::size_t& pos)
 {
     auto now = std::chrono::system_clock::now();
-    auto now_c = std::chrono::system_clock::to_time_t(now);
-    auto now_tm = std::localtime(&now_c);
 
-    char buffer[32];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", now_tm);
+    pos = enqueuePos.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        Slot& slot = slots[pos & slotMask];
+        std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+
+        if (diff == 0)
+        {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.level = level;
+                slot.time = now;
+                slot.length = std::min(message.size(), messageCapacity);
+                std::memcpy(slot.text, message.data(), slot.length);
+
+                if (message.size() > messageCapacity)
+                    std::memcpy(slot.text + messageCapacity - 3, "...", 3);
+
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+            return false; // Full
+        else
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+}
+
+// Formats up to maxBatch queued messages into batch and frees their slots
+std::size_t Logger::drain(std::string& batch)
+{
+    std::size_t count = 0;
+
+    while (count < maxBatch)
+    {
+        Slot& slot = slots[dequeuePos & slotMask];
+
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+            break;
+
+        appendTimestamp(batch, slot.time);
+        batch += " [";
+        batch += getLevelString(slot.level);
+        batch += "] ";
+        batch.append(slot.text, slot.length);
+        batch += '\n';
+
+        slot.sequence.store(dequeuePos + slotMask + 1, std::memory_order_release);
+        ++dequeuePos;
+        ++count;
+    }
+
+    return count;
+}
+
+void Logger::writerLoop()
+{
+    std::string batch;
+    batch.reserve(maxBatch * 64);
+
+    auto lastFlush = std::chrono::steady_clock::now();
+    std::size_t unflushed = 0;
+
+    while (true)
+    {
+        // Read before draining, so everything queued before the stop request
+        // is written
+        bool stop = stopping.load();
+
+        std::size_t count = drain(batch);
+
+        std::size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+
+        if (lost > 0)
+        {
+            appendTimestamp(batch, std::chrono::system_clock::now());
+            batch += " [WARNING] " + std::to_string(lost) + " log messages dropped\n";
+        }
+
+        if (!batch.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (logFile.is_open())
+                    logFile.write(batch.data(), std::streamsize(batch.size()));
+            }
+            {
+                std::lock_guard<std::mutex> lock(consoleMtx);
+                std::cout << batch;
+            }
+
+            unflushed += batch.size();
+            batch.clear();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto interval = flushInterval.load(std::memory_order_relaxed);
+
+        if ((unflushed > 0)
+            && ((unflushed >= flushThreshold) || (now - lastFlush >= interval) || (flushRequests.load() > 0) || stop))
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (logFile.is_open())
+                logFile.flush();
+
+            unflushed = 0;
+            lastFlush = now;
+        }
+
+        if (unflushed == 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(wakeMtx);
+                flushedPos.store(dequeuePos);
+            }
+            flushedCond.notify_all();
+        }
+
+        if (count == maxBatch)
+            continue; // More queued
+
+        if (stop)
+        {
+            if (count == 0)
+                break;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMtx);
+        writerSleeping.store(true);
+
+        wakeCond.wait_for(lock, interval, [this]() {
+            return stopping.load() || (flushRequests.load() > 0 && flushedPos.load() < enqueuePos.load())
+                || (slots[dequeuePos & slotMask].sequence.load(std::memory_order_acquire) == dequeuePos + 1);
+        });
+
+        writerSleeping.store(false);
+    }
+}
+
+// Appends "YYYY-MM-DD HH:MM:SS.mmm". The date and time part only changes once
+// a second, so it is cached per thread and localtime/strftime are only called
+// when the second changes.
+void Logger::appendTimestamp(std::string& out, std::chrono::system_clock::time_point time)
+{
+    thread_local std::time_t cachedSecond = -1;
+    thread_local char prefix[32];
+    thread_local std::size_t prefixLength = 0;
+
+    auto now_c = std::chrono::system_clock::to_time_t(time);
+
+    if (now_c != cachedSecond)
+    {
+        std::tm now_tm;
+#ifdef _WIN32
+        localtime_s(&now_tm, &now_c);
+#else
+        localtime_r(&now_c, &now_tm);
+#endif
+        prefixLength = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &now_tm);
+        cachedSecond = now_c;
+    }
+
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+    int ms = static_cast<int>(now_ms.count());
+
+    if (ms < 0)
+        ms += 1000;
 
-    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      now.time_since_epoch())
-        % 1000;
+    char fraction[4] = { '.', char('0' + ms / 100), char('0' + ms / 10 % 10), char('0' + ms % 10) };
 
-    std::stringstream ss;
-    ss << buffer << "." << std::setfill('0') << std::setw(3) << now_ms.count();
-    return ss.str();
+    out.append(prefix, prefixLength);
+    out.append(fraction, sizeof(fraction));
 }
 
-std::string Logger::getLevelString(LogLevel level)
+std::string_view Logger::getLevelString(LogLevel level)
 {
     switch (level)
     {
@@ -1,9 +1,23 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <format>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+
+// Messages below this level are removed at compile time by the templated
+// log<Level>() calls, 0 = DEBUG ... 4 = FATAL
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
 
 class Logger
 {
@@ -17,6 +31,15 @@ public:
         FATAL
     };
 
+    // What log() does in asynchronous mode when the ring is full
+    enum class OverflowPolicy
+    {
+        DROP,  // Discard the message, the writer reports the number dropped
+        BLOCK  // Wait until the writer thread has freed a slot
+    };
+
+    static constexpr LogLevel minLevel = static_cast<LogLevel>(LOGGER_MIN_LEVEL);
+
     static Logger& getInstance();
 
     // Delete copy constructor and assignment operator
@@ -26,18 +49,98 @@ public:
     void setLogLevel(LogLevel level);
     void setLogFile(const std::string& filename);
 
-    void log(LogLevel level, const std::string& message);
+    void log(LogLevel level, std::string_view message);
+
+    // Formats and logs the message only if Level passes both the compile time
+    // and the run time minimum level, so filtered calls cost a comparison and
+    // calls below minLevel no code at all. Short messages are formatted into
+    // a stack buffer without allocating.
+    //
+    //   logger.log<Logger::LogLevel::INFO>("Adding beam with length {}.", l);
+    template <LogLevel Level, typename... Args>
+    void log(std::format_string<Args...> fmt, Args&&... args)
+    {
+        if constexpr (Level >= minLevel)
+        {
+            if (Level < currentLogLevel.load(std::memory_order_relaxed))
+                return;
+
+            char buffer[256];
+            auto result = std::format_to_n(buffer, sizeof(buffer), fmt, std::forward<Args>(args)...);
+
+            if (result.size <= static_cast<std::ptrdiff_t>(sizeof(buffer)))
+                log(Level, std::string_view(buffer, static_cast<std::size_t>(result.size)));
+            else
+                log(Level, std::format(fmt, std::forward<Args>(args)...));
+        }
+    }
+
+    // In asynchronous mode log() copies the message and a time stamp into a
+    // preallocated slot of a lock-free ring and returns. A background thread
+    // formats the messages, writes them in batches and flushes the file
+    // when flushInterval has passed or enough output has accumulated.
+    // Disabling asynchronous mode, or destroying the logger, writes and
+    // flushes all queued messages first. Switch modes while no other thread
+    // is logging.
+    void setAsync(bool enabled, std::size_t capacity = 1024);
+    bool isAsync() const;
+
+    // Can be changed while logging, a new flush interval takes effect when the
+    // writer thread next wakes up
+    void setOverflowPolicy(OverflowPolicy policy);
+    void setFlushInterval(std::chrono::milliseconds interval);
+
+    // Returns when all messages logged before the call are written and flushed
+    void flush();
+
+    // Messages discarded because the ring was full
+    std::size_t droppedMessages() const;
+
+    // Held by the writer thread while writing to std::cout, for readers of a
+    // redirected std::cout on other threads
+    std::mutex& consoleMutex();
 
 private:
     Logger();
     ~Logger();
 
-    std::string getCurrentTimestamp();
-    std::string getLevelString(LogLevel level);
+    struct Slot;
+
+    void appendTimestamp(std::string& out, std::chrono::system_clock::time_point time);
+    std::string_view getLevelString(LogLevel level);
+
+    bool tryEnqueue(LogLevel level, std::string_view message, std::size_t& pos);
+    std::size_t drain(std::string& batch);
+    void writerLoop();
 
-    LogLevel currentLogLevel;
+    std::atomic<LogLevel> currentLogLevel;
     std::ofstream logFile;
     std::mutex mtx;
+    std::mutex consoleMtx;
+
+    // Asynchronous mode
+
+    std::atomic<bool> async { false };
+    std::atomic<OverflowPolicy> overflowPolicy { OverflowPolicy::DROP };
+    std::atomic<std::chrono::milliseconds> flushInterval { std::chrono::milliseconds(100) };
+    std::size_t flushThreshold { 64 * 1024 }; // Bytes written before a flush is forced
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t slotMask { 0 };
+    alignas(64) std::atomic<std::size_t> enqueuePos { 0 };
+    alignas(64) std::size_t dequeuePos { 0 }; // Writer thread only
+    std::atomic<std::size_t> flushedPos { 0 };
+
+    std::atomic<std::size_t> dropped { 0 };
+    std::atomic<std::size_t> totalDropped { 0 };
+
+    std::thread writer;
+    std::atomic<bool> stopping { false };
+    std::atomic<bool> writerSleeping { false };
+    std::atomic<int> flushRequests { 0 };
+    std::mutex wakeMtx;
+    std::condition_variable wakeCond;
+    std::condition_variable flushedCond;
 };
 
 #endif // LOGGER_H
@@ -51,11 +51,14 @@ MainWindow::MainWindow(QWidget* parent)
     // Setup redirection and logging
 
     m_outputRedirector = std::make_unique<OutputRedirector>(ui->logEdit);
-    m_logger.log(Logger::LogLevel::INFO, "Application started");
+    m_logger.setAsync(true);
+    m_logger.log<Logger::LogLevel::INFO>("Application started");
 }
 
 MainWindow::~MainWindow()
 {
+    // Write queued messages while the output redirector still exists
+    m_logger.setAsync(false);
 }
 
 double MainWindow::toDouble(const QString& str, double defValue)
@@ -112,8 +115,7 @@ void MainWindow::updateModel()
             beam->I(toDouble(ui->IyEdit->text(), beam->I()));
             beam->q(ui->qSpin->value());
         }
-        m_beamModel->connect();
-        m_beamModel->solve();
+        m_beamModel->update();
     }
 }
 
@@ -1,4 +1,5 @@
 #include "output_redirector.h"
+#include "logger.h"
 
 std::vector<std::string> split(const std::string& str, char delim = ' ')
 {
@@ -31,12 +32,22 @@ OutputRedirector::OutputRedirector(QPlainTextEdit* textEdit)
 OutputRedirector::~OutputRedirector()
 {
     // Restore original stdout
+    std::lock_guard<std::mutex> lock(Logger::getInstance().consoleMutex());
     std::cout.rdbuf(originalStdout);
 }
 
 void OutputRedirector::updateText()
 {
-    std::string str = stdoutBuffer.str();
+    // The logger writes to std::cout from its writer thread in asynchronous mode
+
+    std::string str;
+
+    {
+        std::lock_guard<std::mutex> lock(Logger::getInstance().consoleMutex());
+        str = stdoutBuffer.str();
+        stdoutBuffer.str("");
+        stdoutBuffer.clear(std::stringstream::goodbit);
+    }
 
     if (!str.empty())
     {
@@ -46,7 +57,5 @@ void OutputRedirector::updateText()
             textEdit->appendPlainText(QString::fromStdString(token));
 
         // textEdit->appendPlainText(QString::fromStdString(str));
-        stdoutBuffer.str("");
-        stdoutBuffer.clear(std::stringstream::goodbit);
     }
 }
@@ -0,0 +1,151 @@
+#include "function_sampler.h"
+
+#include "exprtk.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+struct FunctionSampler::Impl
+{
+    double x { 0.0 };
+    exprtk::symbol_table<double> symbolTable;
+    exprtk::expression<double> expression;
+    bool compiled { false };
+};
+
+FunctionSampler::FunctionSampler()
+    : m_impl { std::make_unique<Impl>() }
+{
+    m_impl->symbolTable.add_variable("x", m_impl->x);
+    m_impl->symbolTable.add_constants();
+    m_impl->expression.register_symbol_table(m_impl->symbolTable);
+}
+
+FunctionSampler::~FunctionSampler() = default;
+
+bool FunctionSampler::compile(const std::string& expression, std::string& error)
+{
+    exprtk::parser<double> parser;
+
+    m_impl->compiled = parser.compile(expression, m_impl->expression);
+
+    if (!m_impl->compiled)
+        error = parser.error();
+    else
+        error.clear();
+
+    return m_impl->compiled;
+}
+
+bool FunctionSampler::isCompiled() const
+{
+    return m_impl->compiled;
+}
+
+double FunctionSampler::value(double x)
+{
+    if (!m_impl->compiled)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    m_impl->x = x;
+    return m_impl->expression.value();
+}
+
+void FunctionSampler::evaluate(const double* x, double* y, std::size_t n)
+{
+    if (!m_impl->compiled)
+    {
+        std::fill(y, y + n, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    double& xv = m_impl->x;
+    exprtk::expression<double>& expression = m_impl->expression;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        xv = x[i];
+        y[i] = expression.value();
+    }
+}
+
+void FunctionSampler::sampleUniform(
+    double xMin, double xMax, std::size_t n, std::vector<double>& xs, std::vector<double>& ys)
+{
+    n = std::max<std::size_t>(n, 1);
+
+    xs.resize(n + 1);
+    ys.resize(n + 1);
+
+    double dx = (xMax - xMin) / double(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+        xs[i] = xMin + dx * double(i);
+    xs[n] = xMax;
+
+    this->evaluate(xs.data(), ys.data(), xs.size());
+}
+
+void FunctionSampler::sampleAdaptive(double xMin, double xMax, std::size_t n, double tolerance,
+    std::vector<double>& xs, std::vector<double>& ys, int maxDepth, std::size_t maxPoints)
+{
+    n = std::max<std::size_t>(n, 1);
+
+    // The vectors keep their capacity between calls, so replotting with a
+    // similar number of points does not allocate
+
+    xs.clear();
+    ys.clear();
+
+    double dx = (xMax - xMin) / double(n);
+    double x0 = xMin;
+    double y0 = this->value(x0);
+
+    xs.push_back(x0);
+    ys.push_back(y0);
+
+    for (std::size_t i = 1; i <= n; ++i)
+    {
+        double x1 = i < n ? xMin + dx * double(i) : xMax;
+        double y1 = this->value(x1);
+
+        this->refine(x0, y0, x1, y1, 0, tolerance, maxDepth, maxPoints, xs, ys);
+
+        xs.push_back(x1);
+        ys.push_back(y1);
+
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+void FunctionSampler::refine(double x0, double y0, double x1, double y1, int depth, double tolerance, int maxDepth,
+    std::size_t maxPoints, std::vector<double>& xs, std::vector<double>& ys)
+{
+    if ((depth >= maxDepth) || (xs.size() >= maxPoints))
+        return;
+
+    double xm = 0.5 * (x0 + x1);
+    double ym = this->value(xm);
+
+    bool finite0 = std::isfinite(y0);
+    bool finite1 = std::isfinite(y1);
+    bool finiteM = std::isfinite(ym);
+
+    // Outside the domain of the expression there is nothing to refine, at
+    // its edges the interval is bisected to locate the edge
+
+    if (!finite0 && !finite1 && !finiteM)
+        return;
+
+    if (finite0 && finite1 && finiteM && (std::abs(ym - 0.5 * (y0 + y1)) <= tolerance))
+        return;
+
+    this->refine(x0, y0, xm, ym, depth + 1, tolerance, maxDepth, maxPoints, xs, ys);
+
+    xs.push_back(xm);
+    ys.push_back(ym);
+
+    this->refine(xm, ym, x1, y1, depth + 1, tolerance, maxDepth, maxPoints, xs, ys);
+}
@@ -0,0 +1,53 @@
+#ifndef FUNCTION_SAMPLER_H
+#define FUNCTION_SAMPLER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Evaluates a user expression in x, for example "sin(x)*exp(-x^2/10)".
+// The expression is parsed once by compile() into an exprtk expression tree
+// bound to an internal x variable. Evaluating a sample then only assigns x
+// and walks the tree, there is no string handling or allocation per sample.
+
+class FunctionSampler
+{
+public:
+    FunctionSampler();
+    ~FunctionSampler();
+
+    FunctionSampler(const FunctionSampler&) = delete;
+    FunctionSampler& operator=(const FunctionSampler&) = delete;
+
+    // Returns false and a parser message in error if the expression is invalid
+    bool compile(const std::string& expression, std::string& error);
+    bool isCompiled() const;
+
+    double value(double x);
+
+    // y[i] = f(x[i]) for i < n
+    void evaluate(const double* x, double* y, std::size_t n);
+
+    // n + 1 equally spaced samples from xMin to xMax
+    void sampleUniform(double xMin, double xMax, std::size_t n, std::vector<double>& xs, std::vector<double>& ys);
+
+    // Starts from n equally spaced intervals and bisects an interval while
+    // its midpoint deviates more than tolerance from the straight line
+    // between its end points, at most maxDepth times. Flat parts of the curve
+    // keep the initial spacing, steep or oscillating parts and domain edges
+    // get up to 2^maxDepth times more points. Refinement stops when maxPoints
+    // samples have been produced. Samples outside the domain of the
+    // expression are returned as NaN.
+    void sampleAdaptive(double xMin, double xMax, std::size_t n, double tolerance, std::vector<double>& xs,
+        std::vector<double>& ys, int maxDepth = 10, std::size_t maxPoints = 4000000);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+
+    void refine(double x0, double y0, double x1, double y1, int depth, double tolerance, int maxDepth,
+        std::size_t maxPoints, std::vector<double>& xs, std::vector<double>& ys);
+};
+
+#endif // FUNCTION_SAMPLER_H
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include <QMessageBox>
@@ -23,6 +25,7 @@ MainWindow::MainWindow(QWidget* parent)
 
     m_series = new QLineSeries(m_chart);
     m_series->setName("function");
+    m_series->setUseOpenGL(true); // Keeps plots with millions of points interactive
     m_chart->addSeries(m_series);
     m_chartView->setRenderHint(QPainter::Antialiasing);
 
@@ -64,44 +67,48 @@ double MainWindow::toDouble(const QString& str, double defValue)
 void MainWindow::update_plot()
 {
     QString expression = ui->expression_edit->text();
-    QString modified_expr = expression;
 
     this->getData();
 
-    double x = 0.0;
-    double y = 0.0;
+    // The expression is only parsed when it has changed. Sampling evaluates
+    // the compiled expression, so changing the ranges is cheap.
 
-    m_series->clear();
-
-    x = m_minX;
-
-    while (x < m_maxX)
+    if (expression != m_compiledExpression)
     {
-        // To be able to use math expressions we prefix them with Math.
-
-        QString modified_expr = expression;
-        modified_expr.replace("x", QString::number(x));
-        modified_expr.replace("sin(", "Math.sin(");
-        modified_expr.replace("cos(", "Math.cos(");
-        modified_expr.replace("tan(", "Math.tan(");
-        modified_expr.replace("sqrt(", "Math.sqrt(");
-        modified_expr.replace("abs(", "Math.abs(");
-        modified_expr.replace("pow(", "Math.pow(");
+        std::string error;
 
-        // Evaluate expression using the QJSEngine
-
-        QJSValue value = m_jsEngine.evaluate(modified_expr);
-        if (value.isError())
+        if (!m_sampler.compile(expression.toStdString(), error))
         {
-            QMessageBox::warning(this, "Error", "Could not evaluate expression.");
+            m_compiledExpression.clear();
+            QMessageBox::warning(this, "Error", "Could not evaluate expression.\n" + QString::fromStdString(error));
             return;
         }
 
-        double v = value.toNumber();
-        m_series->append(x, v);
-        x += 0.01;
+        m_compiledExpression = expression;
     }
 
+    // Two samples per pixel, refined where the curve deviates more than half
+    // a pixel from a straight line
+
+    int width = std::max(m_chartView->width(), 100);
+    int height = std::max(m_chartView->height(), 100);
+    double tolerance = 0.5 * std::abs(m_maxY - m_minY) / height;
+
+    m_sampler.sampleAdaptive(m_minX, m_maxX, 2 * width, tolerance, m_xs, m_ys);
+
+    // Points outside the domain of the expression are left out
+
+    m_points.clear();
+    m_points.reserve(qsizetype(m_xs.size()));
+
+    for (std::size_t i = 0; i < m_xs.size(); i++)
+        if (std::isfinite(m_ys[i]))
+            m_points.append(QPointF(m_xs[i], m_ys[i]));
+
+    // replace() updates the series with a single signal instead of one per point
+
+    m_series->replace(m_points);
+
     // Update chart parameters
 
     m_series->setName("function of " + expression);
@@ -1,8 +1,9 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include <QJSEngine>
+#include <QList>
 #include <QMainWindow>
+#include <QPointF>
 
 #include <QtCharts/QAbstractBarSeries>
 #include <QtCharts/QAreaSeries>
@@ -21,6 +22,10 @@
 #include <QtCharts/QStackedBarSeries>
 #include <QtCharts/QValueAxis>
 
+#include <vector>
+
+#include "function_sampler.h"
+
 namespace Ui
 {
 class MainWindow;
@@ -61,7 +66,12 @@ private:
     QChart* m_chart;
     QChartView* m_chartView;
     QLineSeries* m_series;
-    QJSEngine m_jsEngine;
+
+    FunctionSampler m_sampler;
+    QString m_compiledExpression;
+    std::vector<double> m_xs;
+    std::vector<double> m_ys;
+    QList<QPointF> m_points;
 };
 
 #endif // MAINWINDOW_H
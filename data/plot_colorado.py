@@ -12,8 +12,11 @@ def plot_colorado():
     """
     Plot Colorado data
     """
-    # Load data
-    data = np.genfromtxt('colorado_elev.csv', delimiter=',')
+    # Load data, the binary export from files16 loads without parsing
+    if os.path.exists('colorado_elev.npy'):
+        data = np.load('colorado_elev.npy')
+    else:
+        data = np.genfromtxt('colorado_elev.csv', delimiter=',')
 
     # Plot
     plt.figure()